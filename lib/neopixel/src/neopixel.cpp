@@ -74,6 +74,7 @@ STM32_Pin_Info* PIN_MAP2 =
   (PIN_MAP2[_pin].gpio_peripheral->BSRRL = PIN_MAP2[_pin].gpio_pin)
 #elif HAL_PLATFORM_NRF52840  // Argon, Boron, Xenon, B SoM, B5 SoM, E SoM X,
                              // Tracker
+#include "neopixel_pwm.h"
 #include "nrf.h"
 #include "nrf_gpio.h"
 #include "pinmap_impl.h"
@@ -89,7 +90,11 @@ NRF5x_Pin_Info* PIN_MAP2 = hal_pin_map();
   (nrf_gpio_pin_set( \
       NRF_GPIO_PIN_MAP(PIN_MAP2[_pin].gpio_port, PIN_MAP2[_pin].gpio_pin)))
 #elif (PLATFORM_ID == 32)  // HAL_PLATFORM_RTL872X
-// nothing extra needed for P2
+#include "neopixel_spi.h"
+#elif (PLATFORM_ID == 3)  // Host simulator (gcc virtual device)
+// frames are handed to the simulated HAL and clocked out by its simulated
+// PWM devices
+#include "neopixel_pwm.h"
 #else
 #error \
     "*** PLATFORM_ID not supported by this library. PLATFORM should be Particle Core, Photon, Electron, Argon, Boron, Xenon, RedBear Duo, B SoM, B5 SoM, E SoM X, Tracker or P2 ***"
@@ -97,29 +102,172 @@ NRF5x_Pin_Info* PIN_MAP2 = hal_pin_map();
 // fast pin access
 #define pinSet(_pin, _hilo) (_hilo ? pinHI(_pin) : pinLO(_pin))
 
+// Gamma 2.6 correction, out = round((in / 255) ^ 2.6 * 255), so that equal
+// steps of the pixel values look like equal steps of brightness
+static const uint8_t GAMMA8[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3,
+    4, 4, 4, 4, 5, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10,
+    10, 11, 11, 11, 12, 12, 13, 13, 13, 14, 14, 15, 15, 16, 16, 17, 17, 18, 18,
+    19, 19, 20, 20, 21, 21, 22, 22, 23, 24, 24, 25, 25, 26, 27, 27, 28, 29, 29,
+    30, 31, 31, 32, 33, 34, 34, 35, 36, 37, 38, 38, 39, 40, 41, 42, 42, 43, 44,
+    45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63,
+    64, 65, 66, 68, 69, 70, 71, 72, 73, 75, 76, 77, 78, 80, 81, 82, 84, 85, 86,
+    88, 89, 90, 92, 93, 94, 96, 97, 99, 100, 102, 103, 105, 106, 108, 109, 111,
+    112, 114, 115, 117, 119, 120, 122, 124, 125, 127, 129, 130, 132, 134, 136,
+    137, 139, 141, 143, 145, 146, 148, 150, 152, 154, 156, 158, 160, 162, 164,
+    166, 168, 170, 172, 174, 176, 178, 180, 182, 184, 186, 188, 191, 193, 195,
+    197, 199, 202, 204, 206, 209, 211, 213, 215, 218, 220, 223, 225, 227, 230,
+    232, 235, 237, 240, 242, 245, 247, 250, 252, 255,
+};
+
+#if (PLATFORM_ID == 32)
+// Zero bytes sent before and after the pixel data as the reset pulse
+static uint16_t spiResetBytes(uint8_t type) {
+  switch (type) {
+    case WS2812B:  // WS2812, WS2812B & WS2813 = 300us reset pulse
+      return 120;  // 300us / (1/3125000Mhz) / 8bits_per_byte
+    case WS2812B_FAST:  // WS2812B_FAST = 50us reset pulse
+    default:            // default = 50us reset pulse
+      return 20;
+  }
+}
+
+// Size of the SPI buffer for a frame of 'numBytes' pixel bytes
+static uint32_t spiBufferBytes(uint16_t numBytes, uint8_t type) {
+  return (uint32_t) numBytes * SPI_BYTES_PER_BYTE + 2 * spiResetBytes(type);
+}
+#endif  // #if (PLATFORM_ID == 32)
+
 #if (PLATFORM_ID == 32)
 Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, SPIClass& spi, uint8_t t)
-    : begun(false), type(t), brightness(0), pixels(NULL), endTime(0) {
+    : begun(false),
+      staticLength(0),
+      type(t),
+      brightness(0),
+      pixels(NULL),
+      endTime(0),
+      dirtyBytes(0),
+      gamma(false),
+      numChannels(1),
+      spiBuffer(NULL),
+      spiBufferSize(0) {
+  updateLength(n);
+  updateOutputLut();
+  spi_ = &spi;
+  channelFirst[0] = 0;
+}
+
+Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n,
+                                     SPIClass& spi,
+                                     uint8_t t,
+                                     uint8_t* pixelBuffer,
+                                     void* staging,
+                                     uint32_t stagingSize)
+    : begun(false),
+      staticLength(n),
+      type(t),
+      brightness(0),
+      pixels(pixelBuffer),
+      endTime(0),
+      dirtyBytes(0),
+      gamma(false),
+      numChannels(1),
+      spiBuffer((uint8_t*) staging),
+      spiBufferSize(stagingSize) {
   updateLength(n);
+  updateOutputLut();
   spi_ = &spi;
+  channelFirst[0] = 0;
 }
 #else
 Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, uint8_t p, uint8_t t)
-    : begun(false), type(t), brightness(0), pixels(NULL), endTime(0) {
+    : begun(false),
+      staticLength(0),
+      type(t),
+      brightness(0),
+      pixels(NULL),
+      endTime(0),
+      dirtyBytes(0),
+      gamma(false),
+      numChannels(1) {
+#if NEOPIXEL_DMA_PWM
+  pattern = NULL;
+  patternSize = 0;
+  memset(dmaDevice, -1, sizeof(dmaDevice));
+  dmaPattern = NULL;
+  showCallback = NULL;
+  asyncShow = false;
+#endif
   updateLength(n);
+  updateOutputLut();
+  setPin(p);
+}
+
+Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n,
+                                     uint8_t p,
+                                     uint8_t t,
+                                     uint8_t* pixelBuffer,
+                                     void* staging,
+                                     uint32_t stagingSize)
+    : begun(false),
+      staticLength(n),
+      type(t),
+      brightness(0),
+      pixels(pixelBuffer),
+      endTime(0),
+      dirtyBytes(0),
+      gamma(false),
+      numChannels(1) {
+#if NEOPIXEL_DMA_PWM
+  pattern = (uint16_t*) staging;
+  patternSize = staging ? stagingSize : 0;
+  memset(dmaDevice, -1, sizeof(dmaDevice));
+  dmaPattern = NULL;
+  showCallback = NULL;
+  asyncShow = false;
+#endif
+  updateLength(n);
+  updateOutputLut();
   setPin(p);
 }
 
 #endif  // #if (PLATFORM_ID == 32)
 
+// Waits until a frame started by showAsync() is clocked out
+void Adafruit_NeoPixel::waitIdle(void) {
+#if (PLATFORM_ID == 3)
+  // The simulated clock only moves when it is advanced, so skip to the end
+  // of the frame instead of spinning. On a node whose clock runs slow that
+  // takes a few steps.
+  while (isBusy())
+    sim::advanceMicros(sim::pwmBusyMicros());
+#endif
+  while (isBusy())
+    ;
+}
+
 Adafruit_NeoPixel::~Adafruit_NeoPixel() {
-  if (pixels)
-    free(pixels);
+  waitIdle();
+  if (!staticLength) {
+    if (pixels)
+      free(pixels);
+#if NEOPIXEL_DMA_PWM
+    if (pattern)
+      free(pattern);
+#endif
+#if (PLATFORM_ID == 32)
+    if (spiBuffer)
+      free(spiBuffer);
+#endif
+  }
 #if (PLATFORM_ID == 32)
   spi_->end();
 #else
-  if (begun)
-    pinMode(pin, INPUT);
+  if (begun) {
+    for (uint8_t c = 0; c < numChannels; c++)
+      pinMode(channelPin[c], INPUT);
+  }
 #endif
 }
 
@@ -132,6 +280,24 @@ uint8_t Adafruit_NeoPixel::getType() const {
 }
 
 void Adafruit_NeoPixel::updateLength(uint16_t n) {
+  waitIdle();
+
+  // Caller-owned buffers are never reallocated, only used in part
+  if (staticLength) {
+    if (n > staticLength)
+      n = staticLength;
+    numLEDs = n;
+    numBytes = n * ((type == SK6812RGBW) ? 4 : 3);
+    memset(pixels, 0, numBytes);
+    dirtyBytes = numBytes;
+#if (PLATFORM_ID == 32)
+    // Zero the reset padding once; show() only rewrites the pixel data
+    if (spiBuffer)
+      memset(spiBuffer, 0, spiBufferSize);
+#endif
+    return;
+  }
+
   if (pixels)
     free(pixels);  // Free existing data (if any)
 
@@ -143,6 +309,40 @@ void Adafruit_NeoPixel::updateLength(uint16_t n) {
   } else {
     numLEDs = numBytes = 0;
   }
+  dirtyBytes = numBytes;
+
+#if NEOPIXEL_DMA_PWM
+  // The EasyDMA pattern is allocated once per strip length and reused by
+  // every show(), so the heap is not churned on each frame. If there is not
+  // enough memory, show() falls back to allocating the pattern per frame.
+  if (pattern)
+    free(pattern);
+  pattern = NULL;
+  patternSize = 0;
+  if (numBytes) {
+    uint32_t size =
+        (numBytes * 8 + 2 * MAX_CHANNELS) * sizeof(uint16_t);
+    if ((pattern = (uint16_t*) malloc(size))) {
+      patternSize = size;
+    }
+  }
+#endif
+
+#if (PLATFORM_ID == 32)
+  // Same for the SPI buffer. Its reset padding is zeroed here once, show()
+  // only rewrites the pixel data in between.
+  if (spiBuffer)
+    free(spiBuffer);
+  spiBuffer = NULL;
+  spiBufferSize = 0;
+  if (numBytes) {
+    uint32_t size = spiBufferBytes(numBytes, type);
+    if ((spiBuffer = (uint8_t*) malloc(size))) {
+      memset(spiBuffer, 0, size);
+      spiBufferSize = size;
+    }
+  }
+#endif
 }
 
 void Adafruit_NeoPixel::begin(void) {
@@ -188,29 +388,96 @@ void Adafruit_NeoPixel::begin(void) {
     }
   }
 #else
-  pinMode(pin, OUTPUT);
-  digitalWrite(pin, LOW);
+  for (uint8_t c = 0; c < numChannels; c++) {
+    pinMode(channelPin[c], OUTPUT);
+    digitalWrite(channelPin[c], LOW);
+  }
 #endif  // #if (PLATFORM_ID == 32)
   begun = true;
 }
 
-// Set the output pin number
+// Set the output pin number (the pin of channel 0)
 void Adafruit_NeoPixel::setPin(uint8_t p) {
   if (begun) {
     pinMode(pin, INPUT);
   }
   pin = p;
+  channelFirst[0] = 0;
+  channelPin[0] = p;
   if (begun) {
     pinMode(p, OUTPUT);
     digitalWrite(p, LOW);
   }
 }
 
+// Split the output across another data line: the LEDs from 'first' up to
+// the next channel's first LED are sent on pin 'p' instead. Pixel indices
+// and the pixel buffer stay the same, only the output is split. On nRF52
+// every channel is clocked out by its own PWM device at the same time, so a
+// frame takes as long as the longest channel rather than the whole strip.
+// Channels must be added in increasing order of 'first'. Returns false if
+// all channels are in use, 'first' is out of order or past the end, or the
+// platform drives a single data line only (P2 SPI, STM32 bit-bang).
+bool Adafruit_NeoPixel::addChannel(uint16_t first, uint8_t p) {
+#if NEOPIXEL_DMA_PWM
+  if (numChannels == MAX_CHANNELS || first <= channelFirst[numChannels - 1] ||
+      first >= numLEDs)
+    return false;
+
+  waitIdle();
+
+  channelFirst[numChannels] = first;
+  channelPin[numChannels] = p;
+  numChannels++;
+  if (begun) {
+    pinMode(p, OUTPUT);
+    digitalWrite(p, LOW);
+  }
+  dirtyBytes = numBytes;  // The new line has not been sent anything yet
+  return true;
+#else
+  (void) first;
+  (void) p;
+  return false;
+#endif
+}
+
+uint8_t Adafruit_NeoPixel::getChannels(void) const {
+  return numChannels;
+}
+
+// Returns how many of the first 'count' pixel bytes go out on channel 'c',
+// and in 'from' the offset of its first byte in the pixel buffer
+uint16_t Adafruit_NeoPixel::channelBytes(uint8_t c,
+                                         uint16_t count,
+                                         uint16_t& from) const {
+  uint8_t bytesPerPixel = (type == SK6812RGBW) ? 4 : 3;
+  uint16_t end =
+      (c + 1 < numChannels) ? channelFirst[c + 1] * bytesPerPixel : numBytes;
+  from = channelFirst[c] * bytesPerPixel;
+  if (end > count)
+    end = count;
+  return (end > from) ? end - from : 0;
+}
+
 void Adafruit_NeoPixel::show(void) {
   if (!pixels)
     return;
 
-#if (PLATFORM_ID != 32)
+  // Let a frame started by showAsync() finish before touching the output
+  waitIdle();
+
+  // Pixels latch the data they receive and keep their color otherwise, so
+  // only the prefix up to the last pixel changed since the previous frame
+  // has to be sent.
+  uint16_t sendBytes = dirtyBytes;
+  dirtyBytes = 0;
+#if (PLATFORM_ID != 3)
+  if (sendBytes == 0)
+    return;
+#endif
+
+#if (PLATFORM_ID != 32) && (PLATFORM_ID != 3)
   // Data latch = 24 or 50 microsecond pause in the output stream.  Rather than
   // put a delay at the end of the function, the ending time is noted and
   // the function will simply hold off (if needed) on issuing the
@@ -244,7 +511,7 @@ void Adafruit_NeoPixel::show(void) {
   // endTime is a private member (rather than global var) so that multiple
   // instances on different pins can be quickly issued in succession (each
   // instance doesn't delay the next).
-#endif  // (PLATFORM_ID != 32)
+#endif  // (PLATFORM_ID != 32) && (PLATFORM_ID != 3)
 
 #if (PLATFORM_ID == 0) || (PLATFORM_ID == 6) || (PLATFORM_ID == 8) || \
     (PLATFORM_ID == 10) ||                                            \
@@ -254,7 +521,8 @@ void Adafruit_NeoPixel::show(void) {
 
   volatile uint32_t c,             // 24-bit/32-bit pixel color
       mask;                        // 1-bit mask
-  volatile uint16_t i = numBytes;  // Output loop counter
+  const uint8_t* lut = outputLut;  // Brightness and gamma
+  volatile uint16_t i = sendBytes;  // Output loop counter
   volatile uint8_t j,              // 8-bit inner loop counter
       *ptr = pixels,               // Pointer to next byte
       g,                           // Current green byte value
@@ -267,9 +535,9 @@ void Adafruit_NeoPixel::show(void) {
     while (i) {                // While bytes left... (3 bytes = 1 pixel)
       mask = 0x800000;         // reset the mask
       i = i - 3;               // decrement bytes remaining
-      g = *ptr++;              // Next green byte value
-      r = *ptr++;              // Next red byte value
-      b = *ptr++;              // Next blue byte value
+      g = lut[*ptr++];         // Next green byte value
+      r = lut[*ptr++];         // Next red byte value
+      b = lut[*ptr++];         // Next blue byte value
       c = ((uint32_t) g << 16) | ((uint32_t) r << 8) |
           b;  // Pack the next 3 bytes to keep timing tight
       j = 0;  // reset the 24-bit counter
@@ -750,10 +1018,10 @@ void Adafruit_NeoPixel::show(void) {
     while (i) {                     // While bytes left... (4 bytes = 1 pixel)
       mask = 0x80000000;            // reset the mask
       i = i - 4;                    // decrement bytes remaining
-      r = *ptr++;                   // Next red byte value
-      g = *ptr++;                   // Next green byte value
-      b = *ptr++;                   // Next blue byte value
-      w = *ptr++;                   // Next white byte value
+      r = lut[*ptr++];              // Next red byte value
+      g = lut[*ptr++];              // Next green byte value
+      b = lut[*ptr++];              // Next blue byte value
+      w = lut[*ptr++];              // Next white byte value
       c = ((uint32_t) r << 24) | ((uint32_t) g << 16) | ((uint32_t) b << 8) |
           w;  // Pack the next 4 bytes to keep timing tight
       j = 0;  // reset the 32-bit counter
@@ -1236,9 +1504,9 @@ void Adafruit_NeoPixel::show(void) {
     while (i) {         // While bytes left... (3 bytes = 1 pixel)
       mask = 0x800000;  // reset the mask
       i = i - 3;        // decrement bytes remaining
-      g = *ptr++;       // Next green byte value
-      r = *ptr++;       // Next red byte value
-      b = *ptr++;       // Next blue byte value
+      g = lut[*ptr++];  // Next green byte value
+      r = lut[*ptr++];  // Next red byte value
+      b = lut[*ptr++];  // Next blue byte value
       c = ((uint32_t) g << 16) | ((uint32_t) r << 8) |
           b;  // Pack the next 3 bytes to keep timing tight
       j = 0;  // reset the 24-bit counter
@@ -1268,9 +1536,9 @@ void Adafruit_NeoPixel::show(void) {
     while (i) {                 // While bytes left... (3 bytes = 1 pixel)
       mask = 0x800000;          // reset the mask
       i = i - 3;                // decrement bytes remaining
-      r = *ptr++;               // Next red byte value
-      g = *ptr++;               // Next green byte value
-      b = *ptr++;               // Next blue byte value
+      r = lut[*ptr++];          // Next red byte value
+      g = lut[*ptr++];          // Next green byte value
+      b = lut[*ptr++];          // Next blue byte value
       c = ((uint32_t) r << 16) | ((uint32_t) g << 8) |
           b;  // Pack the next 3 bytes to keep timing tight
       j = 0;  // reset the 24-bit counter
@@ -2354,9 +2622,9 @@ void Adafruit_NeoPixel::show(void) {
     while (i) {                 // While bytes left... (3 bytes = 1 pixel)
       mask = 0x800000;          // reset the mask
       i = i - 3;                // decrement bytes remaining
-      r = *ptr++;               // Next red byte value
-      g = *ptr++;               // Next blue byte value
-      b = *ptr++;               // Next green byte value
+      r = lut[*ptr++];          // Next red byte value
+      g = lut[*ptr++];          // Next blue byte value
+      b = lut[*ptr++];          // Next green byte value
       c = ((uint32_t) r << 16) | ((uint32_t) g << 8) |
           b;  // Pack the next 3 bytes to keep timing tight
       j = 0;  // reset the 24-bit counter
@@ -3222,9 +3490,9 @@ void Adafruit_NeoPixel::show(void) {
     while (i) {         // While bytes left... (3 bytes = 1 pixel)
       mask = 0x800000;  // reset the mask
       i = i - 3;        // decrement bytes remaining
-      r = *ptr++;       // Next red byte value
-      b = *ptr++;       // Next blue byte value
-      g = *ptr++;       // Next green byte value
+      r = lut[*ptr++];  // Next red byte value
+      b = lut[*ptr++];  // Next blue byte value
+      g = lut[*ptr++];  // Next green byte value
       c = ((uint32_t) r << 16) | ((uint32_t) b << 8) |
           g;             // Pack the next 3 bytes to keep timing tight
       j = 0;             // reset the 24-bit counter
@@ -3644,56 +3912,35 @@ void Adafruit_NeoPixel::show(void) {
     return;
   }
 
-  constexpr uint8_t PIX_HI = 0b110;
-  constexpr uint8_t PIX_LO = 0b100;
-
-  uint16_t resetOff = 120;  // 300us / (1/3125000Mhz) / 8bits_per_byte
-  switch (type) {
-    case WS2812B: {  // WS2812, WS2812B & WS2813 = 300us reset pulse
-      resetOff = 120;
-    } break;
-    case WS2812B_FAST:  // WS2812B_FAST = 50us reset pulse
-    default: {          // default = 50us reset pulse
-      resetOff = 20;
-    } break;
-  }
-
-  constexpr uint8_t numBitsPerBit =
-      3;  // How many SPI bits represent one neopixel bit
-  uint32_t spiArraySize = (numBytes * numBitsPerBit) + resetOff + resetOff;
+  uint16_t resetOff = spiResetBytes(type);
+  uint32_t spiArraySize = spiBufferBytes(numBytes, type);
+  uint32_t dataEnd = resetOff + (uint32_t) sendBytes * SPI_BYTES_PER_BYTE;
   uint8_t* spiArray = NULL;
-  spiArray = (uint8_t*) malloc(spiArraySize);
-
-  if (spiArray == NULL) {
-    Log.error("Not enough memory available!");
-    return;
+  if (spiBuffer != NULL && spiBufferSize >= spiArraySize) {
+    spiArray = spiBuffer;
+  } else {
+    // No persistent buffer, fall back to one per frame
+    spiArray = (uint8_t*) malloc(spiArraySize);
+    if (spiArray == NULL) {
+      Log.error("Not enough memory available!");
+      return;
+    }
+    memset(spiArray, 0, spiArraySize);
   }
 
-  memset(spiArray, 0, spiArraySize);
   // expand pixel data and pack into spi buffer
-  for (int x = 0; x < numPixels(); x++) {
-    for (int s = 0; s < 3; s++) {
-      spiArray[(x * 9) + (s * 3) + 0 + resetOff] =
-          ((0x80 & pixels[(x * 3) + s]) ? (PIX_HI << 5) : (PIX_LO << 5)) +
-          ((0x40 & pixels[(x * 3) + s]) ? (PIX_HI << 2) : (PIX_LO << 2)) +
-          ((0x20 & pixels[(x * 3) + s]) ? (0b11) : (0b10));
-      spiArray[(x * 9) + (s * 3) + 1 + resetOff] =
-          0 /* bit 7 always 0 */ +
-          ((0x10 & pixels[(x * 3) + s]) ? (PIX_HI << 4) : (PIX_LO << 4)) +
-          ((0x08 & pixels[(x * 3) + s]) ? (PIX_HI << 1) : (PIX_LO << 1)) +
-          1 /* bit 0 always 1 */;
-      spiArray[(x * 9) + (s * 3) + 2 + resetOff] =
-          ((0x04 & pixels[(x * 3) + s]) ? (0b10 << 6) : (0b00 << 6)) +
-          ((0x02 & pixels[(x * 3) + s]) ? (PIX_HI << 3) : (PIX_LO << 3)) +
-          ((0x01 & pixels[(x * 3) + s]) ? (PIX_HI) : (PIX_LO));
-    }
-  }
+  expandSpiBytes(pixels, sendBytes, outputLut, spiArray + resetOff);
 
+  // Leading reset and the changed prefix, then the trailing reset padding
+  // from the end of the buffer
   spi_->beginTransaction();
-  spi_->transfer(spiArray, nullptr, spiArraySize, nullptr);
+  spi_->transfer(spiArray, nullptr, dataEnd, nullptr);
+  spi_->transfer(spiArray + spiArraySize - resetOff, nullptr, resetOff,
+                 nullptr);
   spi_->endTransaction();
 
-  free(spiArray);
+  if (spiArray != spiBuffer)
+    free(spiArray);
 
 #elif HAL_PLATFORM_NRF52840  // Argon, Boron, Xenon, B SoM, B5 SoM, E SoM X,
                              // Tracker
@@ -3714,27 +3961,7 @@ void Adafruit_NeoPixel::show(void) {
 //   * Cycle time:  1.25us
 //   * Frequency: 800Khz
 // For 400Khz we just double the calculated times.
-// ---------- BEGIN Constants for the EasyDMA implementation -----------
-// The PWM starts the duty cycle in LOW. To start with HIGH we
-// need to set the 15th bit on each register.
-
-// WS2812 (rev A) timing is 0.35 and 0.7us
-// #define MAGIC_T0H               5UL | (0x8000) // 0.3125us
-// #define MAGIC_T1H              12UL | (0x8000) // 0.75us
-
-// WS2812B (rev B) timing is 0.4 and 0.8 us
-#define MAGIC_T0H 6UL | (0x8000)          // 0.375us
-#define MAGIC_T1H 13UL | (0x8000)         // 0.8125us
-
-// WS2811 (400 khz) timing is 0.5 and 1.2
-#define MAGIC_T0H_400KHz 8UL | (0x8000)   // 0.5us
-#define MAGIC_T1H_400KHz 19UL | (0x8000)  // 1.1875us
-
-// For 400Khz, we double value of CTOPVAL
-#define CTOPVAL 20UL                      // 1.25us
-#define CTOPVAL_400KHz 40UL               // 2.5us
-
-// ---------- END Constants for the EasyDMA implementation -------------
+// The EasyDMA constants and the pattern encoding are in neopixel_pwm.h.
 //
 // If there is no device available an alternative cycle-counter
 // implementation is tried.
@@ -3754,151 +3981,22 @@ void Adafruit_NeoPixel::show(void) {
   // ---------- END of Constants for cycle counter implementation --------
 
   // To support both the SoftDevice + Neopixels we use the EasyDMA
-  // feature from the NRF25. However this technique implies to
-  // generate a pattern and store it on the memory. The actual
-  // memory used in bytes corresponds to the following formula:
-  //              totalMem = numBytes*8*2+(2*2)
-  // The two additional bytes at the end are needed to reset the
-  // sequence.
+  // feature from the NRF25. The pattern generation and PWM setup live in
+  // startDmaShow() so that showAsync() can return while the peripheral is
+  // still clocking the frame out; show() simply waits for it here.
   //
-  // If there is not enough memory, we will fall back to cycle counter
-  // using DWT
-  uint32_t pattern_size =
-      numBytes * 8 * sizeof(uint16_t) + 2 * sizeof(uint16_t);
-  uint16_t* pixels_pattern = NULL;
-
-  NRF_PWM_Type* pwm = NULL;
-
-  // Try to find a free PWM device, which is not enabled
-  // and has no connected pins
-  NRF_PWM_Type* PWM[3] = {NRF_PWM0, NRF_PWM1, NRF_PWM2};
-  for (int device = 0; device < 3; device++) {
-    if ((PWM[device]->ENABLE == 0) &&
-        (PWM[device]->PSEL.OUT[0] & PWM_PSEL_OUT_CONNECT_Msk) &&
-        (PWM[device]->PSEL.OUT[1] & PWM_PSEL_OUT_CONNECT_Msk) &&
-        (PWM[device]->PSEL.OUT[2] & PWM_PSEL_OUT_CONNECT_Msk) &&
-        (PWM[device]->PSEL.OUT[3] & PWM_PSEL_OUT_CONNECT_Msk)) {
-      pwm = PWM[device];
-      break;
-    }
-  }
-
-  // only malloc if there is PWM device available
-  if (pwm != NULL) {
-#ifdef ARDUINO_FEATHER52   // use thread-safe malloc
-    pixels_pattern = (uint16_t*) rtos_malloc(pattern_size);
-#else
-    pixels_pattern = (uint16_t*) malloc(pattern_size);
-#endif
-  }
-
-  // Use the identified device to choose the implementation
-  // If a PWM device is available use DMA
-  if ((pixels_pattern != NULL) && (pwm != NULL)) {
-    uint16_t pos = 0;  // bit position
-
-    for (uint16_t n = 0; n < numBytes; n++) {
-      uint8_t pix = pixels[n];
-
-      for (uint8_t mask = 0x80, i = 0; mask > 0; mask >>= 1, i++) {
-#ifdef NEO_KHZ400
-        if (!is800KHz) {
-          pixels_pattern[pos] =
-              (pix & mask) ? MAGIC_T1H_400KHz : MAGIC_T0H_400KHz;
-        } else
-#endif
-        {
-          pixels_pattern[pos] = (pix & mask) ? MAGIC_T1H : MAGIC_T0H;
-        }
-
-        pos++;
-      }
-    }
-
-    // Zero padding to indicate the end of que sequence
-    pixels_pattern[++pos] = 0 | (0x8000);  // Seq end
-    pixels_pattern[++pos] = 0 | (0x8000);  // Seq end
-
-    // Set the wave mode to count UP
-    pwm->MODE = (PWM_MODE_UPDOWN_Up << PWM_MODE_UPDOWN_Pos);
-
-    // Set the PWM to use the 16MHz clock
-    pwm->PRESCALER =
-        (PWM_PRESCALER_PRESCALER_DIV_1 << PWM_PRESCALER_PRESCALER_Pos);
-
-    // Setting of the maximum count
-    // but keeping it on 16Mhz allows for more granularity just
-    // in case someone wants to do more fine-tuning of the timing.
-#ifdef NEO_KHZ400
-    if (!is800KHz) {
-      pwm->COUNTERTOP = (CTOPVAL_400KHz << PWM_COUNTERTOP_COUNTERTOP_Pos);
-    } else
-#endif
-    {
-      pwm->COUNTERTOP = (CTOPVAL << PWM_COUNTERTOP_COUNTERTOP_Pos);
-    }
-
-    // Disable loops, we want the sequence to repeat only once
-    pwm->LOOP = (PWM_LOOP_CNT_Disabled << PWM_LOOP_CNT_Pos);
-
-    // On the "Common" setting the PWM uses the same pattern for the
-    // for supported sequences. The pattern is stored on half-word
-    // of 16bits
-    pwm->DECODER = (PWM_DECODER_LOAD_Common << PWM_DECODER_LOAD_Pos) |
-                   (PWM_DECODER_MODE_RefreshCount << PWM_DECODER_MODE_Pos);
-
-    // Pointer to the memory storing the patter
-    pwm->SEQ[0].PTR = (uint32_t) (pixels_pattern) << PWM_SEQ_PTR_PTR_Pos;
-
-    // Calculation of the number of steps loaded from memory.
-    pwm->SEQ[0].CNT = (pattern_size / sizeof(uint16_t)) << PWM_SEQ_CNT_CNT_Pos;
-
-    // The following settings are ignored with the current config.
-    pwm->SEQ[0].REFRESH = 0;
-    pwm->SEQ[0].ENDDELAY = 0;
-
-    // The Neopixel implementation is a blocking algorithm. DMA
-    // allows for non-blocking operation. To "simulate" a blocking
-    // operation we enable the interruption for the end of sequence
-    // and block the execution thread until the event flag is set by
-    // the peripheral.
-    //    pwm->INTEN |= (PWM_INTEN_SEQEND0_Enabled<<PWM_INTEN_SEQEND0_Pos);
-
-    // PSEL must be configured before enabling PWM
-    pwm->PSEL.OUT[0] =
-        NRF_GPIO_PIN_MAP(PIN_MAP2[pin].gpio_port, PIN_MAP2[pin].gpio_pin);
-
-    // Enable the PWM
-    pwm->ENABLE = 1;
-
-    // After all of this and many hours of reading the documentation
-    // we are ready to start the sequence...
-    pwm->EVENTS_SEQEND[0] = 0;
-    pwm->TASKS_SEQSTART[0] = 1;
-
-    // But we have to wait for the flag to be set.
-    while (!pwm->EVENTS_SEQEND[0]) {
+  // If there is no PWM device or not enough memory, we will fall back to
+  // cycle counter using DWT
+  if (startDmaShow(sendBytes)) {
+    if (!asyncShow) {
+      // The Neopixel implementation is a blocking algorithm. To "simulate"
+      // a blocking operation we wait for the end of sequence event.
+      while (isBusy()) {
 #ifdef ARDUINO_FEATHER52
-      yield();
+        yield();
 #endif
+      }
     }
-
-    // Before leave we clear the flag for the event.
-    pwm->EVENTS_SEQEND[0] = 0;
-
-    // We need to disable the device and disconnect
-    // all the outputs before leave or the device will not
-    // be selected on the next call.
-    // TODO: Check if disabling the device causes performance issues.
-    pwm->ENABLE = 0;
-
-    pwm->PSEL.OUT[0] = 0xFFFFFFFFUL;
-
-#ifdef ARDUINO_FEATHER52  // use thread-safe free
-    rtos_free(pixels_pattern);
-#else
-    free(pixels_pattern);
-#endif
   }  // End of DMA implementation
   // ---------------------------------------------------------------------
   else {
@@ -3916,9 +4014,6 @@ void Adafruit_NeoPixel::show(void) {
     __disable_irq();
 #endif
 
-    uint32_t pinMask = 1UL << NRF_GPIO_PIN_MAP(PIN_MAP2[pin].gpio_port,
-                                               PIN_MAP2[pin].gpio_pin);
-
     uint32_t CYCLES_X00 = CYCLES_800;
     uint32_t CYCLES_X00_T1H = CYCLES_800_T1H;
     uint32_t CYCLES_X00_T0H = CYCLES_800_T0H;
@@ -3935,45 +4030,59 @@ void Adafruit_NeoPixel::show(void) {
     CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
     DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 
-    // Tries to re-send the frame if is interrupted by the SoftDevice.
-    while (1) {
-      uint8_t* p = pixels;
+    // Without a PWM device the channels go out one after the other
+    for (uint8_t c = 0; c < numChannels; c++) {
+      uint16_t from;
+      uint16_t channelSend = channelBytes(c, sendBytes, from);
+      if (channelSend == 0)
+        continue;
 
-      uint32_t cycStart = DWT->CYCCNT;
-      uint32_t cyc = 0;
+      uint8_t channelOut = channelPin[c];
+      uint32_t pinMask =
+          1UL << NRF_GPIO_PIN_MAP(PIN_MAP2[channelOut].gpio_port,
+                                  PIN_MAP2[channelOut].gpio_pin);
 
-      for (uint16_t n = 0; n < numBytes; n++) {
-        uint8_t pix = *p++;
+      // Tries to re-send the frame if is interrupted by the SoftDevice.
+      while (1) {
+        uint8_t* p = pixels + from;
 
-        for (uint8_t mask = 0x80; mask; mask >>= 1) {
-          while (DWT->CYCCNT - cyc < CYCLES_X00)
-            ;
-          cyc = DWT->CYCCNT;
+        uint32_t cycStart = DWT->CYCCNT;
+        uint32_t cyc = 0;
 
-          NRF_GPIO->OUTSET |= pinMask;
+        for (uint16_t n = 0; n < channelSend; n++) {
+          uint8_t pix = outputLut[*p++];
 
-          if (pix & mask) {
-            while (DWT->CYCCNT - cyc < CYCLES_X00_T1H)
-              ;
-          } else {
-            while (DWT->CYCCNT - cyc < CYCLES_X00_T0H)
+          for (uint8_t mask = 0x80; mask; mask >>= 1) {
+            while (DWT->CYCCNT - cyc < CYCLES_X00)
               ;
+            cyc = DWT->CYCCNT;
+
+            NRF_GPIO->OUTSET |= pinMask;
+
+            if (pix & mask) {
+              while (DWT->CYCCNT - cyc < CYCLES_X00_T1H)
+                ;
+            } else {
+              while (DWT->CYCCNT - cyc < CYCLES_X00_T0H)
+                ;
+            }
+
+            NRF_GPIO->OUTCLR |= pinMask;
           }
+        }
+        while (DWT->CYCCNT - cyc < CYCLES_X00)
+          ;
 
-          NRF_GPIO->OUTCLR |= pinMask;
+        // If total time longer than 25%, resend the whole data.
+        // Since we are likely to be interrupted by SoftDevice
+        if ((DWT->CYCCNT - cycStart) <
+            (8 * channelSend * ((CYCLES_X00 * 5) / 4))) {
+          break;
         }
-      }
-      while (DWT->CYCCNT - cyc < CYCLES_X00)
-        ;
 
-      // If total time longer than 25%, resend the whole data.
-      // Since we are likely to be interrupted by SoftDevice
-      if ((DWT->CYCCNT - cycStart) < (8 * numBytes * ((CYCLES_X00 * 5) / 4))) {
-        break;
+        // re-send need 300us delay
+        delayMicroseconds(300);
       }
-
-      // re-send need 300us delay
-      delayMicroseconds(300);
     }
 
 // Enable interrupts again
@@ -3985,9 +4094,266 @@ void Adafruit_NeoPixel::show(void) {
   }
   // END of NRF52 implementation
 
+#elif (PLATFORM_ID == 3)  // Host simulator (gcc virtual device)
+  // The simulated HAL records the frame, which then goes through the same
+  // EasyDMA path as on nRF52, on simulated PWM devices that stay busy for
+  // its wire time. Nothing else runs while a blocking show() would wait, so
+  // it returns with the frame already out.
+  uint16_t channelFrom[MAX_CHANNELS];
+  uint16_t channelSent[MAX_CHANNELS];
+  for (uint8_t c = 0; c < numChannels; c++)
+    channelSent[c] = channelBytes(c, sendBytes, channelFrom[c]);
+  sim::captureFrame(pixels, numBytes, channelFrom, channelSent, numChannels,
+                    outputLut);
+  if (startDmaShow(sendBytes) && !asyncShow)
+    finishDmaShow();
+#endif
+  endTime = micros();  // Save EOD time for latch on next call
+}
+
+// Start show() without waiting for the frame to be clocked out. On nRF52
+// the EasyDMA PWM sequence keeps running in the background; poll isBusy()
+// (or call show()/showAsync() again, which wait as needed) to complete it.
+// Completion is poll-driven: no SEQEND interrupt is used, so the PWM
+// peripheral stays claimed and the optional callback does not run until one
+// of those calls observes the finished sequence. The callback is therefore
+// late by up to the caller's polling period. The host simulator runs the
+// same path on its simulated PWM devices. On other platforms the frame is
+// sent synchronously and the callback runs before returning.
+void Adafruit_NeoPixel::showAsync(void (*callback)(void)) {
+#if NEOPIXEL_DMA_PWM
+  asyncShow = true;
+  show();
+  asyncShow = false;
+  if (isBusy()) {
+    showCallback = callback;
+    return;
+  }
+#else
+  show();
+#endif
+  if (callback)
+    callback();
+}
+
+// Returns true while an asynchronous frame is still being clocked out. The
+// first call that finds the sequence finished releases the PWM peripheral
+// and runs the showAsync() callback.
+bool Adafruit_NeoPixel::isBusy(void) {
+#if NEOPIXEL_DMA_PWM
+  bool started = false;
+  for (uint8_t c = 0; c < MAX_CHANNELS; c++) {
+    if (dmaDevice[c] < 0)
+      continue;
+    if (!pwmSequenceEnded(dmaDevice[c]))
+      return true;
+    started = true;
+  }
+  if (started)
+    finishDmaShow();
+#endif
+  return false;
+}
+
+#if HAL_PLATFORM_NRF52840
+// The PWM devices of neopixel_pwm.h, on the nRF52 registers
+static NRF_PWM_Type* const PWM[PWM_DEVICES] = {NRF_PWM0, NRF_PWM1, NRF_PWM2,
+                                               NRF_PWM3};
+
+// A device is free if it is not enabled and has no connected pins
+int8_t pwmFreeDevice(uint8_t from) {
+  for (uint8_t device = from; device < PWM_DEVICES; device++) {
+    if ((PWM[device]->ENABLE == 0) &&
+        (PWM[device]->PSEL.OUT[0] & PWM_PSEL_OUT_CONNECT_Msk) &&
+        (PWM[device]->PSEL.OUT[1] & PWM_PSEL_OUT_CONNECT_Msk) &&
+        (PWM[device]->PSEL.OUT[2] & PWM_PSEL_OUT_CONNECT_Msk) &&
+        (PWM[device]->PSEL.OUT[3] & PWM_PSEL_OUT_CONNECT_Msk))
+      return device;
+  }
+  return -1;
+}
+
+void pwmLoadSequence(uint8_t device,
+                     uint8_t pin,
+                     const uint16_t* pattern,
+                     uint32_t words) {
+  NRF_PWM_Type* pwm = PWM[device];
+
+  // Set the wave mode to count UP
+  pwm->MODE = (PWM_MODE_UPDOWN_Up << PWM_MODE_UPDOWN_Pos);
+
+  // Set the PWM to use the 16MHz clock
+  pwm->PRESCALER =
+      (PWM_PRESCALER_PRESCALER_DIV_1 << PWM_PRESCALER_PRESCALER_Pos);
+
+  // Setting of the maximum count
+  // but keeping it on 16Mhz allows for more granularity just
+  // in case someone wants to do more fine-tuning of the timing.
+#ifdef NEO_KHZ400
+  if (!is800KHz) {
+    pwm->COUNTERTOP = (CTOPVAL_400KHz << PWM_COUNTERTOP_COUNTERTOP_Pos);
+  } else
+#endif
+  {
+    pwm->COUNTERTOP = (CTOPVAL << PWM_COUNTERTOP_COUNTERTOP_Pos);
+  }
+
+  // Disable loops, we want the sequence to repeat only once
+  pwm->LOOP = (PWM_LOOP_CNT_Disabled << PWM_LOOP_CNT_Pos);
+
+  // On the "Common" setting the PWM uses the same pattern for the
+  // for supported sequences. The pattern is stored on half-word
+  // of 16bits
+  pwm->DECODER = (PWM_DECODER_LOAD_Common << PWM_DECODER_LOAD_Pos) |
+                 (PWM_DECODER_MODE_RefreshCount << PWM_DECODER_MODE_Pos);
+
+  // Pointer to the memory storing the patter
+  pwm->SEQ[0].PTR = (uint32_t) (pattern) << PWM_SEQ_PTR_PTR_Pos;
+
+  // Calculation of the number of steps loaded from memory.
+  pwm->SEQ[0].CNT = words << PWM_SEQ_CNT_CNT_Pos;
+
+  // The following settings are ignored with the current config.
+  pwm->SEQ[0].REFRESH = 0;
+  pwm->SEQ[0].ENDDELAY = 0;
+
+  // PSEL must be configured before enabling PWM
+  pwm->PSEL.OUT[0] =
+      NRF_GPIO_PIN_MAP(PIN_MAP2[pin].gpio_port, PIN_MAP2[pin].gpio_pin);
+
+  // Enable the PWM
+  pwm->ENABLE = 1;
+}
+
+void pwmStartSequence(uint8_t device) {
+  PWM[device]->EVENTS_SEQEND[0] = 0;
+  PWM[device]->TASKS_SEQSTART[0] = 1;
+}
+
+bool pwmSequenceEnded(uint8_t device) {
+  return PWM[device]->EVENTS_SEQEND[0];
+}
+
+void pwmRelease(uint8_t device) {
+  NRF_PWM_Type* pwm = PWM[device];
+
+  // Before leave we clear the flag for the event.
+  pwm->EVENTS_SEQEND[0] = 0;
+
+  // We need to disable the device and disconnect
+  // all the outputs before leave or the device will not
+  // be selected on the next call.
+  // TODO: Check if disabling the device causes performance issues.
+  pwm->ENABLE = 0;
+
+  pwm->PSEL.OUT[0] = 0xFFFFFFFFUL;
+}
+#endif  // HAL_PLATFORM_NRF52840
+
+#if NEOPIXEL_DMA_PWM
+// Generate the PWM pattern for the first 'count' pixel bytes and start the
+// EasyDMA sequences, one PWM device per channel with data to send, all
+// clocking out at the same time. Returns false if not enough PWM devices or
+// no pattern memory is available, in which case the caller falls back to
+// the DWT implementation.
+bool Adafruit_NeoPixel::startDmaShow(uint16_t count) {
+  // Each channel gets its own region of the pattern, one word per bit plus
+  // the two words at the end needed to reset the sequence:
+  //              totalMem = sum(bytes*8*2+(2*2))
+  uint16_t from[MAX_CHANNELS];
+  uint16_t bytes[MAX_CHANNELS];
+  uint32_t patternWords = 0;
+  for (uint8_t c = 0; c < numChannels; c++) {
+    bytes[c] = channelBytes(c, count, from[c]);
+    if (bytes[c])
+      patternWords += pwmPatternWords(bytes[c]);
+  }
+  uint32_t pattern_size = patternWords * sizeof(uint16_t);
+  uint16_t* pixels_pattern = NULL;
+
+  int8_t device[MAX_CHANNELS];
+
+  // Try to find a free PWM device for each channel
+  uint8_t nextDevice = 0;
+  for (uint8_t c = 0; c < numChannels; c++) {
+    device[c] = -1;
+    if (bytes[c] == 0)
+      continue;
+    device[c] = pwmFreeDevice(nextDevice);
+    if (device[c] < 0)
+      return false;
+    nextDevice = device[c] + 1;
+  }
+
+  // Prefer the pattern buffer preallocated by updateLength(), and only
+  // malloc if no buffer was reserved
+  if (pattern != NULL && patternSize >= pattern_size) {
+    pixels_pattern = pattern;
+  } else {
+#ifdef ARDUINO_FEATHER52  // use thread-safe malloc
+    pixels_pattern = (uint16_t*) rtos_malloc(pattern_size);
+#else
+    pixels_pattern = (uint16_t*) malloc(pattern_size);
 #endif
+    if (pixels_pattern == NULL)
+      return false;
+  }
+
+  encodePwmChannels(pixels, from, bytes, numChannels, outputLut,
+                    pixels_pattern);
+
+  uint16_t* channel_pattern = pixels_pattern;
+  for (uint8_t c = 0; c < numChannels; c++) {
+    if (device[c] < 0)
+      continue;
+
+    uint32_t words = pwmPatternWords(bytes[c]);
+    pwmLoadSequence(device[c], channelPin[c], channel_pattern, words);
+
+    // Keep track of the running sequence so isBusy() can complete it
+    dmaDevice[c] = device[c];
+    channel_pattern += words;
+  }
+  dmaPattern = pixels_pattern;
+
+  // After all of this and many hours of reading the documentation
+  // we are ready to start the sequences, back to back so the channels
+  // clock out in parallel
+  for (uint8_t c = 0; c < numChannels; c++) {
+    if (device[c] >= 0)
+      pwmStartSequence(device[c]);
+  }
+
+  return true;
+}
+
+// Release the PWM devices once every end of sequence event has been seen
+// and run the completion callback of showAsync(), if any.
+void Adafruit_NeoPixel::finishDmaShow(void) {
+  for (uint8_t c = 0; c < MAX_CHANNELS; c++) {
+    if (dmaDevice[c] < 0)
+      continue;
+    pwmRelease(dmaDevice[c]);
+    dmaDevice[c] = -1;
+  }
+
+  if (dmaPattern != pattern) {
+#ifdef ARDUINO_FEATHER52  // use thread-safe free
+    rtos_free(dmaPattern);
+#else
+    free(dmaPattern);
+#endif
+  }
+
+  dmaPattern = NULL;
   endTime = micros();  // Save EOD time for latch on next call
+
+  void (*callback)(void) = showCallback;
+  showCallback = NULL;
+  if (callback)
+    callback();
 }
+#endif  // NEOPIXEL_DMA_PWM
 
 // Set pixel color from separate R,G,B components:
 void Adafruit_NeoPixel::setPixelColor(uint16_t n,
@@ -3995,11 +4361,7 @@ void Adafruit_NeoPixel::setPixelColor(uint16_t n,
                                       uint8_t g,
                                       uint8_t b) {
   if (n < numLEDs) {
-    if (brightness) {  // See notes in setBrightness()
-      r = (r * brightness) >> 8;
-      g = (g * brightness) >> 8;
-      b = (b * brightness) >> 8;
-    }
+    markDirty(n);
     uint8_t* p = &pixels[n * 3];
     switch (type) {
       case WS2812B:  // WS2812, WS2812B & WS2813 is GRB order.
@@ -4033,12 +4395,7 @@ void Adafruit_NeoPixel::setPixelColor(uint16_t n,
 void Adafruit_NeoPixel::setPixelColor(
     uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w) {
   if (n < numLEDs) {
-    if (brightness) {  // See notes in setBrightness()
-      r = (r * brightness) >> 8;
-      g = (g * brightness) >> 8;
-      b = (b * brightness) >> 8;
-      w = (w * brightness) >> 8;
-    }
+    markDirty(n);
     uint8_t* p = &pixels[n * (type == SK6812RGBW ? 4 : 3)];
     switch (type) {
       case WS2812B:  // WS2812, WS2812B & WS2813 is GRB order.
@@ -4078,12 +4435,8 @@ void Adafruit_NeoPixel::setPixelColor(
 // If RGB+W color, order of bytes is WRGB in packed 32-bit form
 void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c) {
   if (n < numLEDs) {
+    markDirty(n);
     uint8_t r = (uint8_t) (c >> 16), g = (uint8_t) (c >> 8), b = (uint8_t) c;
-    if (brightness) {  // See notes in setBrightness()
-      r = (r * brightness) >> 8;
-      g = (g * brightness) >> 8;
-      b = (b * brightness) >> 8;
-    }
     uint8_t* p = &pixels[n * (type == SK6812RGBW ? 4 : 3)];
     switch (type) {
       case WS2812B:  // WS2812, WS2812B & WS2813 is GRB order.
@@ -4107,7 +4460,7 @@ void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c) {
         *p++ = r;
         *p++ = g;
         *p++ = b;
-        *p = brightness ? ((w * brightness) >> 8) : w;
+        *p = w;
       } break;
       case WS2811:  // WS2811 is RGB order
       case TM1803:  // TM1803 is RGB order
@@ -4120,6 +4473,27 @@ void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c) {
   }
 }
 
+// Set 'count' pixels starting at 'first' to the same packed color. The
+// color order is applied once, to the first pixel, whose bytes are then
+// copied to the rest of the run, and the run is marked dirty once.
+void Adafruit_NeoPixel::fill(uint16_t first, uint16_t count, uint32_t c) {
+  if (first >= numLEDs || count == 0)
+    return;
+  if (count > numLEDs - first)
+    count = numLEDs - first;
+
+  // Let setPixelColor() handle color order for the first one
+  setPixelColor(first, c);
+  markDirty(first + count - 1);
+
+  uint8_t bpp = (type == SK6812RGBW) ? 4 : 3;
+  const uint8_t* src = &pixels[first * bpp];
+  uint8_t* end = pixels + (first + count) * bpp;
+  for (uint8_t* p = pixels + (first + 1) * bpp; p < end; p += bpp) {
+    memcpy(p, src, bpp);
+  }
+}
+
 void Adafruit_NeoPixel::setColor(uint16_t aLedNumber,
                                  byte aRed,
                                  byte aGreen,
@@ -4217,22 +4591,12 @@ uint32_t Adafruit_NeoPixel::getPixelColor(uint16_t n) const {
     } break;
   }
 
-  // Adjust this back up to the true color, as setting a pixel color will
-  // scale it back down again.
-  if (brightness) {  // See notes in setBrightness()
-    // Cast the color to a byte array
-    uint8_t* c_ptr = reinterpret_cast<uint8_t*>(&c);
-    if (type == SK6812RGBW) {
-      c_ptr[3] = (c_ptr[3] << 8) / brightness;
-    }
-    c_ptr[0] = (c_ptr[0] << 8) / brightness;
-    c_ptr[1] = (c_ptr[1] << 8) / brightness;
-    c_ptr[2] = (c_ptr[2] << 8) / brightness;
-  }
-  return c;  // Pixel # is out of bounds
+  return c;
 }
 
 uint8_t* Adafruit_NeoPixel::getPixels(void) const {
+  // The caller may write anywhere, so the next show() sends the whole strip
+  dirtyBytes = numBytes;
   return pixels;
 }
 
@@ -4244,18 +4608,12 @@ uint16_t Adafruit_NeoPixel::getNumLeds(void) const {
   return numPixels();
 }
 
-// Adjust output brightness; 0=darkest (off), 255=brightest.  This does
-// NOT immediately affect what's currently displayed on the LEDs.  The
-// next call to show() will refresh the LEDs at this level.  However,
-// this process is potentially "lossy," especially when increasing
-// brightness.  The tight timing in the WS2811/WS2812 code means there
-// aren't enough free cycles to perform this scaling on the fly as data
-// is issued.  So we make a pass through the existing color data in RAM
-// and scale it (subsequent graphics commands also work at this
-// brightness level).  If there's a significant step up in brightness,
-// the limited number of steps (quantization) in the old data will be
-// quite visible in the re-scaled version.  For a non-destructive
-// change, you'll need to re-render the full strip data.  C'est la vie.
+// Adjust output brightness; 0=darkest (off), 255=brightest. The pixel data
+// keeps the colors exactly as they were set; brightness (and gamma, see
+// setGamma()) is applied through a 256-entry LUT while the frame is clocked
+// out. Changing it is therefore lossless and exactly reversible, costs
+// nothing in setPixelColor(), and the next call to show() refreshes the
+// whole strip at the new level.
 void Adafruit_NeoPixel::setBrightness(uint8_t b) {
   // Stored brightness value is different than what's passed.
   // This simplifies the actual scaling math later, allowing a fast
@@ -4264,23 +4622,31 @@ void Adafruit_NeoPixel::setBrightness(uint8_t b) {
   // (color values are interpreted literally; no scaling), 1 = min
   // brightness (off), 255 = just below max brightness.
   uint8_t newBrightness = b + 1;
-  if (newBrightness != brightness) {  // Compare against prior value
-    // Brightness has changed -- re-scale existing data in RAM
-    uint8_t c, *ptr = pixels,
-               oldBrightness = brightness - 1;  // De-wrap old brightness value
-    uint16_t scale;
-    if (oldBrightness == 0)
-      scale = 0;  // Avoid /0
-    else if (b == 255)
-      scale = 65535 / oldBrightness;
-    else
-      scale = (((uint16_t) newBrightness << 8) - 1) / oldBrightness;
-    for (uint16_t i = 0; i < numBytes; i++) {
-      c = *ptr;
-      *ptr++ = (c * scale) >> 8;
-    }
+  if (newBrightness != brightness) {
     brightness = newBrightness;
+    updateOutputLut();
+  }
+}
+
+// Enable or disable gamma correction of the output, see GAMMA8
+void Adafruit_NeoPixel::setGamma(bool enable) {
+  if (enable != gamma) {
+    gamma = enable;
+    updateOutputLut();
+  }
+}
+
+bool Adafruit_NeoPixel::getGamma(void) const {
+  return gamma;
+}
+
+// Rebuild the LUT every pixel byte goes through on its way out
+void Adafruit_NeoPixel::updateOutputLut(void) {
+  for (uint16_t i = 0; i < 256; i++) {
+    uint8_t c = gamma ? GAMMA8[i] : i;
+    outputLut[i] = brightness ? (c * brightness) >> 8 : c;
   }
+  dirtyBytes = numBytes;
 }
 
 // Return the brightness value
@@ -4290,4 +4656,5 @@ uint8_t Adafruit_NeoPixel::getBrightness(void) const {
 
 void Adafruit_NeoPixel::clear(void) {
   memset(pixels, 0, numBytes);
+  dirtyBytes = numBytes;
 }
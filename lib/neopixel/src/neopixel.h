@@ -56,6 +56,15 @@
 
 #include "Particle.h"
 
+// nRF52 parts clock frames out with EasyDMA PWM. A host build gets the same
+// show path by defining NEOPIXEL_PWM_HOST and implementing the PWM device
+// functions of neopixel_pwm.h itself.
+#if HAL_PLATFORM_NRF52840 || defined(NEOPIXEL_PWM_HOST)
+#define NEOPIXEL_DMA_PWM 1
+#else
+#define NEOPIXEL_DMA_PWM 0
+#endif
+
 // 'type' flags for LED pixels (third parameter to constructor):
 #define WS2811 0x00         // 400 KHz datastream (NeoPixel)
 #define WS2812 0x02         // 800 KHz datastream (NeoPixel)
@@ -70,6 +79,9 @@
 
 class Adafruit_NeoPixel {
  public:
+  // Most data lines one strip can be split across, see addChannel()
+  static const uint8_t MAX_CHANNELS = 4;
+
   // Constructor: number of LEDs, pin number, LED type
 #if (PLATFORM_ID == 32)
   Adafruit_NeoPixel(uint16_t n, SPIClass& spi, uint8_t t = WS2812B);
@@ -82,7 +94,8 @@ class Adafruit_NeoPixel {
       setPin(uint8_t p),
       setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b),
       setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w),
-      setPixelColor(uint16_t n, uint32_t c), setBrightness(uint8_t),
+      setPixelColor(uint16_t n, uint32_t c),
+      fill(uint16_t first, uint16_t count, uint32_t c), setBrightness(uint8_t),
       setColor(uint16_t aLedNumber, byte aRed, byte aGreen, byte aBlue),
       setColor(
           uint16_t aLedNumber, byte aRed, byte aGreen, byte aBlue, byte aWhite),
@@ -116,18 +129,108 @@ class Adafruit_NeoPixel {
       Color(uint8_t r, uint8_t g, uint8_t b, uint8_t w);
   uint32_t getPixelColor(uint16_t n) const;
   byte brightnessToPWM(byte aBrightness);
+  void showAsync(void (*callback)(void) = NULL);
+  bool isBusy(void);
+  void setGamma(bool enable);
+  bool getGamma(void) const;
+  bool addChannel(uint16_t first, uint8_t p);
+  uint8_t getChannels(void) const;
+
+ protected:
+  // Used by StaticNeoPixel: the strip uses 'pixelBuffer' (n pixels) and
+  // 'staging' (the nRF52 EasyDMA pattern or the P2 SPI buffer, 'stagingSize'
+  // bytes, or NULL) instead of allocating them on the heap.
+#if (PLATFORM_ID == 32)
+  Adafruit_NeoPixel(uint16_t n,
+                    SPIClass& spi,
+                    uint8_t t,
+                    uint8_t* pixelBuffer,
+                    void* staging,
+                    uint32_t stagingSize);
+#else
+  Adafruit_NeoPixel(uint16_t n,
+                    uint8_t p,
+                    uint8_t t,
+                    uint8_t* pixelBuffer,
+                    void* staging,
+                    uint32_t stagingSize);
+#endif  // #if (PLATFORM_ID == 32)
 
  private:
   bool begun;          // true if begin() previously called
   uint16_t numLEDs,    // Number of RGB LEDs in strip
-      numBytes;        // Size of 'pixels' buffer below
+      numBytes,        // Size of 'pixels' buffer below
+      staticLength;    // Capacity of caller-owned buffers, 0 if heap allocated
   const uint8_t type;  // Pixel type flag (400 vs 800 KHz)
   uint8_t pin,         // Output pin number
       brightness,
       *pixels;       // Holds LED color values (3 bytes each)
   uint32_t endTime;  // Latch timing reference
+  mutable uint16_t dirtyBytes;  // Prefix changed since show(), sent next time
+  bool gamma;                   // true if output is gamma corrected
+  uint8_t outputLut[256];       // Brightness and gamma, applied on output
+  void updateOutputLut(void);
+  // Channel 0 sends from LED 0 on 'pin', channel c from LED
+  // channelFirst[c] on channelPin[c], each up to the next channel's first
+  uint8_t numChannels;
+  uint16_t channelFirst[MAX_CHANNELS];
+  uint8_t channelPin[MAX_CHANNELS];
+  uint16_t channelBytes(uint8_t c, uint16_t count, uint16_t& from) const;
+  void waitIdle(void);
 #if (PLATFORM_ID == 32)
   SPIClass* spi_;
+  uint8_t* spiBuffer;      // Caller-owned SPI buffer, or NULL
+  uint32_t spiBufferSize;  // Size of 'spiBuffer' in bytes
+#endif
+  // Extend the prefix sent by the next show() up to and including pixel 'n'
+  void markDirty(uint16_t n) {
+    uint16_t end = (n + 1) * ((type == SK6812RGBW) ? 4 : 3);
+    if (end > dirtyBytes)
+      dirtyBytes = end;
+  }
+#if NEOPIXEL_DMA_PWM
+  uint16_t* pattern;     // EasyDMA PWM pattern, sized by updateLength()
+  uint32_t patternSize;  // Size of 'pattern' buffer in bytes
+  int8_t dmaDevice[MAX_CHANNELS];  // PWM device clocking out each channel
+  uint16_t* dmaPattern;            // Pattern in use by 'dmaDevice'
+  void (*showCallback)(void);  // Run by the isBusy() poll that sees completion
+  bool asyncShow;              // true while showAsync() is calling show()
+  bool startDmaShow(uint16_t count);
+  void finishDmaShow(void);
+#endif
+};
+
+/*
+  Strip with compile-time sized storage: the pixel buffer and the nRF52
+  EasyDMA pattern or P2 SPI buffer are members, so all memory shows up at
+  link time and the heap is never used. The length can be reduced with
+  updateLength() but never grown beyond N.
+
+    StaticNeoPixel<176, WS2812B> strip(D8);
+*/
+template <uint16_t N, uint8_t T = WS2812B>
+class StaticNeoPixel : public Adafruit_NeoPixel {
+ public:
+#if (PLATFORM_ID == 32)
+  explicit StaticNeoPixel(SPIClass& spi)
+      : Adafruit_NeoPixel(N, spi, T, pixelBuffer, staging, sizeof(staging)) {}
+#elif NEOPIXEL_DMA_PWM
+  explicit StaticNeoPixel(uint8_t p = 2)
+      : Adafruit_NeoPixel(N, p, T, pixelBuffer, staging, sizeof(staging)) {}
+#else
+  explicit StaticNeoPixel(uint8_t p = 2)
+      : Adafruit_NeoPixel(N, p, T, pixelBuffer, NULL, 0) {}
+#endif
+
+ private:
+  static constexpr uint32_t NUM_BYTES = N * ((T == SK6812RGBW) ? 4 : 3);
+
+  uint8_t pixelBuffer[NUM_BYTES];
+#if (PLATFORM_ID == 32)
+  uint8_t staging[NUM_BYTES * 3 + 2 * 120];  // 3 SPI bits per bit plus reset
+#elif NEOPIXEL_DMA_PWM
+  // One PWM word per bit plus two end words per channel
+  uint16_t staging[NUM_BYTES * 8 + 2 * MAX_CHANNELS];
 #endif
 };
 
@@ -0,0 +1,126 @@
+/*-------------------------------------------------------------------------
+  EasyDMA PWM pattern encoding for the nRF52 show() path of the Adafruit
+  NeoPixel library.
+
+  Kept free of any register access so the encoding can be built and checked
+  on a host. The PWM devices themselves are only reached through the
+  functions declared at the end, which neopixel.cpp implements on the nRF52
+  registers and a host build can implement on simulated devices.
+
+  NeoPixel is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+  -------------------------------------------------------------------------*/
+
+#ifndef NEOPIXEL_PWM_H
+#define NEOPIXEL_PWM_H
+
+#include <stdint.h>
+
+// ---------- BEGIN Constants for the EasyDMA implementation -----------
+// The PWM starts the duty cycle in LOW. To start with HIGH we
+// need to set the 15th bit on each register.
+
+// WS2812 (rev A) timing is 0.35 and 0.7us
+// #define MAGIC_T0H               5UL | (0x8000) // 0.3125us
+// #define MAGIC_T1H              12UL | (0x8000) // 0.75us
+
+// WS2812B (rev B) timing is 0.4 and 0.8 us
+#define MAGIC_T0H 6UL | (0x8000)          // 0.375us
+#define MAGIC_T1H 13UL | (0x8000)         // 0.8125us
+
+// WS2811 (400 khz) timing is 0.5 and 1.2
+#define MAGIC_T0H_400KHz 8UL | (0x8000)   // 0.5us
+#define MAGIC_T1H_400KHz 19UL | (0x8000)  // 1.1875us
+
+// For 400Khz, we double value of CTOPVAL
+#define CTOPVAL 20UL                      // 1.25us
+#define CTOPVAL_400KHz 40UL               // 2.5us
+
+// ---------- END Constants for the EasyDMA implementation -------------
+
+// Pattern words needed for 'numBytes' pixel bytes: one per bit plus the
+// two sequence end words
+static inline uint32_t pwmPatternWords(uint16_t numBytes) {
+  return (uint32_t) numBytes * 8 + 2;
+}
+
+// Expand each pixel bit, after mapping the byte through the output LUT,
+// into one 16-bit PWM compare value, followed by the two sequence end words.
+// 'pattern' must hold pwmPatternWords(numBytes) entries.
+static inline void encodePwmPattern(const uint8_t* pixels,
+                                    uint16_t numBytes,
+                                    const uint8_t* lut,
+                                    uint16_t* pattern) {
+  uint32_t pos = 0;  // bit position
+
+  for (uint16_t n = 0; n < numBytes; n++) {
+    uint8_t pix = lut[pixels[n]];
+
+    for (uint8_t mask = 0x80; mask > 0; mask >>= 1) {
+#ifdef NEO_KHZ400
+      if (!is800KHz) {
+        pattern[pos] = (pix & mask) ? MAGIC_T1H_400KHz : MAGIC_T0H_400KHz;
+      } else
+#endif
+      {
+        pattern[pos] = (pix & mask) ? MAGIC_T1H : MAGIC_T0H;
+      }
+
+      pos++;
+    }
+  }
+
+  // Zero padding to indicate the end of que sequence. These must land in
+  // the two words right after the pixel data: the pattern buffer is reused
+  // between frames, so nothing past its end may be written.
+  pattern[pos++] = 0 | (0x8000);  // Seq end
+  pattern[pos] = 0 | (0x8000);    // Seq end
+}
+
+// Encode the sequence of every channel that has data, one after the other
+// in 'pattern': channel c covers bytes[c] pixel bytes from pixels + from[c].
+// Channels with no bytes get no region. Returns the pattern words used.
+static inline uint32_t encodePwmChannels(const uint8_t* pixels,
+                                         const uint16_t* from,
+                                         const uint16_t* bytes,
+                                         uint8_t channels,
+                                         const uint8_t* lut,
+                                         uint16_t* pattern) {
+  uint32_t words = 0;
+  for (uint8_t c = 0; c < channels; c++) {
+    if (bytes[c] == 0)
+      continue;
+    encodePwmPattern(pixels + from[c], bytes[c], lut, pattern + words);
+    words += pwmPatternWords(bytes[c]);
+  }
+  return words;
+}
+
+// ---------- PWM devices ----------------------------------------------
+// Number of PWM devices a strip can clock its channels out on
+#define PWM_DEVICES 4
+
+// Index of the first PWM device from 'from' on that is free, i.e. disabled
+// and with no pins connected, or -1 if there is none
+int8_t pwmFreeDevice(uint8_t from);
+
+// Set 'device' up to clock out the 'words' pattern words at 'pattern' once
+// on pin 'pin', and enable it. The device stays enabled, and so not free,
+// until pwmRelease().
+void pwmLoadSequence(uint8_t device,
+                     uint8_t pin,
+                     const uint16_t* pattern,
+                     uint32_t words);
+
+// Start the sequence loaded on 'device'
+void pwmStartSequence(uint8_t device);
+
+// true once the sequence started on 'device' has been clocked out
+bool pwmSequenceEnded(uint8_t device);
+
+// Clear the end of sequence event, disable 'device' and disconnect its pin
+void pwmRelease(uint8_t device);
+
+#endif  // NEOPIXEL_PWM_H
@@ -0,0 +1,47 @@
+/*-------------------------------------------------------------------------
+  SPI bit expansion for the P2 show() path of the Adafruit NeoPixel
+  library.
+
+  Kept free of any SPI access so the expansion can be built and checked on
+  a host.
+
+  NeoPixel is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+  -------------------------------------------------------------------------*/
+
+#ifndef NEOPIXEL_SPI_H
+#define NEOPIXEL_SPI_H
+
+#include <stdint.h>
+
+// The P2 sends each pixel bit as 3 SPI bits at 3.125 MHz: 0b110 for a one
+// and 0b100 for a zero. SPI_NIBBLE holds the 12 SPI bits of every nibble, so
+// a pixel byte expands to (SPI_NIBBLE[hi] << 12) | SPI_NIBBLE[lo], sent MSB
+// first as 3 bytes.
+static const uint16_t SPI_NIBBLE[16] = {
+    0x924, 0x926, 0x934, 0x936, 0x9A4, 0x9A6, 0x9B4, 0x9B6,
+    0xD24, 0xD26, 0xD34, 0xD36, 0xDA4, 0xDA6, 0xDB4, 0xDB6,
+};
+
+// SPI bytes clocked out per pixel byte
+static const uint8_t SPI_BYTES_PER_BYTE = 3;
+
+// Expand pixel bytes, mapped through the output LUT, into their SPI bit
+// patterns. 'out' must hold numBytes * SPI_BYTES_PER_BYTE bytes.
+static inline void expandSpiBytes(const uint8_t* pixels,
+                                  uint16_t numBytes,
+                                  const uint8_t* lut,
+                                  uint8_t* out) {
+  for (uint16_t n = 0; n < numBytes; n++) {
+    uint8_t pix = lut[pixels[n]];
+    uint32_t bits =
+        ((uint32_t) SPI_NIBBLE[pix >> 4] << 12) | SPI_NIBBLE[pix & 0x0F];
+    *out++ = bits >> 16;
+    *out++ = bits >> 8;
+    *out++ = bits;
+  }
+}
+
+#endif  // NEOPIXEL_SPI_H
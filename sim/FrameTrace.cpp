@@ -0,0 +1,315 @@
+#include "FrameTrace.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace trace {
+
+static const char MAGIC[4] = {'P', 'C', 'T', 'R'};
+
+// Delta kinds and flags, see FrameTrace.h
+enum Kind : uint32_t { NEW = 0, SAME_RUNS = 1, REPEAT = 2 };
+static const uint32_t KIND_MASK = 0x03;
+static const uint32_t ONE_COLOR = 0x04;
+static const int VALUE_SHIFT = 3;
+
+static void writeVarint(FILE* file, uint32_t value) {
+  while (value >= 0x80) {
+    fputc((value & 0x7F) | 0x80, file);
+    value >>= 7;
+  }
+  fputc(value, file);
+}
+
+static bool readVarint(FILE* file, uint32_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    int c = fgetc(file);
+    if (c == EOF) {
+      return false;
+    }
+    value |= (uint32_t) (c & 0x7F) << shift;
+    if (!(c & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool samePixel(const uint8_t* a, const uint8_t* b) {
+  return memcmp(a, b, BYTES_PER_PIXEL) == 0;
+}
+
+/**
+ * @brief Position of 'delta' in the history, 0 for the most recent
+ *
+ * @return Position, or -1 if it is not in the history
+ */
+int DeltaHistory::find(const Delta& delta) const {
+  for (size_t i = 0; i < deltas.size(); i++) {
+    if (deltas[deltas.size() - 1 - i] == delta) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief Makes 'delta' the most recent one, dropping the oldest if the
+ * history is full
+ */
+void DeltaHistory::use(const Delta& delta) {
+  int position = find(delta);
+  if (position >= 0) {
+    deltas.erase(deltas.end() - 1 - position);
+  } else if (deltas.size() == HISTORY) {
+    deltas.erase(deltas.begin());
+  }
+  deltas.push_back(delta);
+}
+
+const Delta& DeltaHistory::at(size_t position) const {
+  return deltas[deltas.size() - 1 - position];
+}
+
+static bool oneColor(const Delta& delta) {
+  for (size_t i = BYTES_PER_PIXEL; i < delta.colors.size(); i++) {
+    if (delta.colors[i] != delta.colors[i % BYTES_PER_PIXEL]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Writer::~Writer() {
+  close();
+}
+
+/**
+ * @brief Creates the trace file; the header is written with the first frame
+ */
+bool Writer::open(const char* path) {
+  close();
+  file = fopen(path, "wb");
+  headerWritten = false;
+  lastTimeMs = 0;
+  previous.clear();
+  lastDelta = Delta();
+  history.clear();
+  return file != nullptr;
+}
+
+/**
+ * @brief Appends one frame, delta encoded against the previous one
+ *
+ * @param timeMs Time the frame was shown
+ * @param pixels Frame bytes in strip order
+ * @param numBytes Frame size, the same for every frame of a trace
+ */
+void Writer::write(uint32_t timeMs, const uint8_t* pixels, uint16_t numBytes) {
+  if (!file) {
+    return;
+  }
+
+  if (!headerWritten) {
+    fwrite(MAGIC, 1, sizeof(MAGIC), file);
+    fputc(VERSION, file);
+    fputc(numBytes & 0xFF, file);
+    fputc(numBytes >> 8, file);
+    previous.assign(numBytes, 0);
+    headerWritten = true;
+  }
+  if (numBytes != previous.size()) {
+    return;
+  }
+
+  // Collect runs of changed pixels sharing one color
+  Delta delta;
+  uint32_t numPixels = numBytes / BYTES_PER_PIXEL;
+  uint32_t skip = 0;
+  for (uint32_t i = 0; i < numPixels;) {
+    const uint8_t* p = pixels + i * BYTES_PER_PIXEL;
+    if (samePixel(p, &previous[i * BYTES_PER_PIXEL])) {
+      skip++;
+      i++;
+      continue;
+    }
+    uint32_t count = 1;
+    while (i + count < numPixels) {
+      const uint8_t* q = pixels + (i + count) * BYTES_PER_PIXEL;
+      if (!samePixel(q, p) ||
+          samePixel(q, &previous[(i + count) * BYTES_PER_PIXEL])) {
+        break;
+      }
+      count++;
+    }
+    delta.runs.push_back(skip);
+    delta.runs.push_back(count);
+    delta.colors.insert(delta.colors.end(), p, p + BYTES_PER_PIXEL);
+    skip = 0;
+    i += count;
+  }
+
+  writeVarint(file, timeMs - lastTimeMs);
+  int position = history.find(delta);
+  if (position >= 0) {
+    writeVarint(file, (position << VALUE_SHIFT) | REPEAT);
+  } else {
+    bool single = oneColor(delta);
+    uint32_t flags = single ? ONE_COLOR : 0;
+    if (delta.runs == lastDelta.runs) {
+      writeVarint(file, flags | SAME_RUNS);
+    } else {
+      writeVarint(file, ((delta.runs.size() / 2) << VALUE_SHIFT) | flags | NEW);
+      for (uint32_t value : delta.runs) {
+        writeVarint(file, value);
+      }
+    }
+    size_t colorBytes =
+        single ? std::min(delta.colors.size(), (size_t) BYTES_PER_PIXEL)
+               : delta.colors.size();
+    fwrite(delta.colors.data(), 1, colorBytes, file);
+  }
+  history.use(delta);
+  lastDelta = delta;
+
+  memcpy(previous.data(), pixels, numBytes);
+  lastTimeMs = timeMs;
+}
+
+void Writer::close() {
+  if (file) {
+    fclose(file);
+    file = nullptr;
+  }
+}
+
+Reader::~Reader() {
+  close();
+}
+
+/**
+ * @brief Opens a trace file and checks its header
+ *
+ * Traces of version 1, where every frame is NEW without the kind and flag
+ * bits and each run's color follows its pixel count, are read as well.
+ */
+bool Reader::open(const char* path) {
+  close();
+  file = fopen(path, "rb");
+  if (!file) {
+    return false;
+  }
+
+  char magic[sizeof(MAGIC)];
+  uint8_t header[3];
+  if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+      memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      fread(header, 1, sizeof(header), file) != sizeof(header) ||
+      header[0] < 1 || header[0] > VERSION) {
+    close();
+    return false;
+  }
+
+  version = header[0];
+  timeMs = 0;
+  current.assign(header[1] | (header[2] << 8), 0);
+  lastDelta = Delta();
+  history.clear();
+  return true;
+}
+
+/**
+ * @brief Decodes the next frame
+ *
+ * @param timeMs Output parameter for the time the frame was shown
+ * @param pixels Output parameter for the frame bytes, valid until the next
+ *        call
+ * @return true if a frame was read, false at the end of the trace or if it
+ *         is corrupt
+ */
+bool Reader::next(uint32_t& frameTimeMs, const uint8_t*& pixels) {
+  uint32_t deltaMs, header;
+  if (!file || !readVarint(file, deltaMs) || !readVarint(file, header)) {
+    return false;
+  }
+
+  Delta delta;
+  if (version == 1) {
+    header <<= VALUE_SHIFT;
+  }
+  uint32_t value = header >> VALUE_SHIFT;
+  switch (header & KIND_MASK) {
+    case REPEAT:
+      if (value >= history.size()) {
+        return false;
+      }
+      delta = history.at(value);
+      break;
+    case SAME_RUNS:
+      delta.runs = lastDelta.runs;
+      break;
+    case NEW:
+      if (value > current.size() / BYTES_PER_PIXEL) {
+        return false;
+      }
+      delta.runs.resize(value * 2);
+      delta.colors.resize(value * BYTES_PER_PIXEL);
+      for (uint32_t r = 0; r < value; r++) {
+        if (!readVarint(file, delta.runs[r * 2]) ||
+            !readVarint(file, delta.runs[r * 2 + 1]) ||
+            (version == 1 &&
+             fread(&delta.colors[r * BYTES_PER_PIXEL], 1, BYTES_PER_PIXEL,
+                   file) != BYTES_PER_PIXEL)) {
+          return false;
+        }
+      }
+      break;
+    default:
+      return false;
+  }
+  if (version > 1 && (header & KIND_MASK) != REPEAT) {
+    size_t runCount = delta.runs.size() / 2;
+    delta.colors.resize(runCount * BYTES_PER_PIXEL);
+    size_t colorBytes = (header & ONE_COLOR) && runCount
+                            ? BYTES_PER_PIXEL
+                            : delta.colors.size();
+    if (fread(delta.colors.data(), 1, colorBytes, file) != colorBytes) {
+      return false;
+    }
+    for (size_t i = colorBytes; i < delta.colors.size(); i++) {
+      delta.colors[i] = delta.colors[i % BYTES_PER_PIXEL];
+    }
+  }
+
+  uint32_t numPixels = current.size() / BYTES_PER_PIXEL;
+  uint32_t pixel = 0;
+  for (size_t r = 0; r < delta.runs.size() / 2; r++) {
+    uint32_t skip = delta.runs[r * 2], count = delta.runs[r * 2 + 1];
+    const uint8_t* color = &delta.colors[r * BYTES_PER_PIXEL];
+    if (skip > numPixels - pixel || count > numPixels - pixel - skip) {
+      return false;
+    }
+    pixel += skip;
+    for (uint32_t i = 0; i < count; i++, pixel++) {
+      memcpy(&current[pixel * BYTES_PER_PIXEL], color, BYTES_PER_PIXEL);
+    }
+  }
+  history.use(delta);
+  lastDelta = delta;
+
+  timeMs += deltaMs;
+  frameTimeMs = timeMs;
+  pixels = current.data();
+  return true;
+}
+
+void Reader::close() {
+  if (file) {
+    fclose(file);
+    file = nullptr;
+  }
+}
+
+}  // namespace trace
@@ -0,0 +1,120 @@
+#ifndef __SIM_FRAMETRACE_H
+#define __SIM_FRAMETRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+/**
+ * @brief Compact binary recording of every LED frame sent by show()
+ *
+ * File layout (all integers little endian, varints are unsigned LEB128):
+ * - Header: "PCTR", version byte, frame size in bytes (uint16)
+ * - Per frame: varint milliseconds since the previous frame (since boot for
+ *   the first), then the frame's delta (see Delta): a varint holding the
+ *   kind in bits 0-1, ONE_COLOR in bit 2 and a value above, followed by
+ *   - NEW: value is the run count; for each run varint pixels skipped since
+ *     the previous run and varint pixel count, then the colors
+ *   - SAME_RUNS: the runs of the previous frame's delta, then the colors
+ *   - REPEAT: value is the position of an earlier delta in the history of
+ *     the last HISTORY distinct deltas, most recent first; nothing follows
+ *   Colors are 3 bytes per run, or 3 bytes for all runs with ONE_COLOR.
+ *
+ * Each frame is delta encoded against the previous one: only pixels that
+ * changed are stored, as runs of identical color. A segment display mostly
+ * changes whole segments to one color, and the same changes come back
+ * often (a rainbow recolors the same digits every frame, the tenths digit
+ * counts through the same ten steps every second), so most frames cost a
+ * few bytes and an hour of practice fits in a few hundred KB.
+ */
+namespace trace {
+
+static const uint8_t VERSION = 2;
+static const uint8_t BYTES_PER_PIXEL = 3;
+static const size_t HISTORY = 64;
+
+/**
+ * @brief The changes from one frame to the next
+ */
+struct Delta {
+  std::vector<uint32_t> runs;   // Pixels skipped, pixel count, for each run
+  std::vector<uint8_t> colors;  // BYTES_PER_PIXEL per run
+
+  bool operator==(const Delta& other) const {
+    return runs == other.runs && colors == other.colors;
+  }
+};
+
+/**
+ * @brief The last HISTORY distinct deltas, the most recently used last
+ *
+ * Writer and Reader keep the same history, so a delta can be referred to
+ * by its position.
+ */
+class DeltaHistory {
+ public:
+  int find(const Delta& delta) const;
+  void use(const Delta& delta);
+  const Delta& at(size_t position) const;
+  size_t size() const {
+    return deltas.size();
+  }
+  void clear() {
+    deltas.clear();
+  }
+
+ private:
+  std::vector<Delta> deltas;
+};
+
+/**
+ * @brief Writes frames to a trace file
+ */
+class Writer {
+ public:
+  ~Writer();
+
+  bool open(const char* path);
+  void write(uint32_t timeMs, const uint8_t* pixels, uint16_t numBytes);
+  void close();
+
+ private:
+  FILE* file = nullptr;
+  bool headerWritten = false;
+  uint32_t lastTimeMs = 0;
+  std::vector<uint8_t> previous;
+  Delta lastDelta;
+  DeltaHistory history;
+};
+
+/**
+ * @brief Reads frames back from a trace file
+ */
+class Reader {
+ public:
+  ~Reader();
+
+  bool open(const char* path);
+  bool next(uint32_t& frameTimeMs, const uint8_t*& pixels);
+  void close();
+
+  /**
+   * @brief Size of every frame in bytes
+   */
+  uint16_t frameSize() const {
+    return (uint16_t) current.size();
+  }
+
+ private:
+  FILE* file = nullptr;
+  uint8_t version = VERSION;
+  uint32_t timeMs = 0;
+  std::vector<uint8_t> current;
+  Delta lastDelta;
+  DeltaHistory history;
+};
+
+}  // namespace trace
+
+#endif /* __SIM_FRAMETRACE_H */
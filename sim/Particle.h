@@ -0,0 +1,226 @@
+#ifndef __SIM_PARTICLE_H
+#define __SIM_PARTICLE_H
+
+/**
+ * @brief Simulated Particle HAL for building the firmware on a Linux host
+ *
+ * Provides just the parts of the Device OS API the clock firmware and the
+ * neopixel library use, backed by:
+ * - A virtual clock: millis()/micros() only move when the simulation
+ *   advances them (or the firmware calls delay())
+ * - Scripted pin levels, which fire attached edge interrupts on change
+ * - An in-process mesh bus that delivers publishes to the other nodes and
+ *   injects events
+ * - A capture hook for every Adafruit_NeoPixel::show()
+ * - The PWM devices the neopixel library's EasyDMA show runs on (see
+ *   neopixel_pwm.h), busy for each frame's wire time
+ * - Cloud string variables that can be read back by name
+ *
+ * Several clocks can run in one process as nodes (see sim::addNode()). Each
+ * has its own pins, mesh subscriptions, serial input, cloud variables, frame
+ * capture and local clock; the HAL calls act on the selected node, which is
+ * node 0 unless another one is selected.
+ *
+ * Built with PLATFORM_ID 3, the Device OS id of the gcc virtual device.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <functional>
+
+#ifndef PLATFORM_ID
+#define PLATFORM_ID 3
+#endif
+
+// The neopixel library shows frames through the PWM devices in sim_hal.cpp
+#define NEOPIXEL_PWM_HOST
+
+typedef uint32_t system_tick_t;
+typedef uint8_t byte;
+typedef uint16_t pin_t;
+
+// Pins
+enum {
+  D0 = 0, D1, D2, D3, D4, D5, D6, D7, D8,
+  SIM_PIN_COUNT = 32,
+};
+
+enum PinMode { INPUT, OUTPUT, INPUT_PULLUP, INPUT_PULLDOWN };
+enum InterruptMode { CHANGE, RISING, FALLING };
+#define LOW 0
+#define HIGH 1
+
+// System configuration macros have no effect in the simulator
+#define SYSTEM_THREAD(state)
+#define SYSTEM_MODE(mode)
+
+// Nothing preempts the simulated application thread: runs the block once
+#define ATOMIC_BLOCK() for (bool _once = true; _once; _once = false)
+
+namespace sim {
+
+/**
+ * @brief Hook called with every frame sent by Adafruit_NeoPixel::show(),
+ * with the colors the LEDs show after it
+ */
+typedef std::function<void(system_tick_t now, const uint8_t* pixels,
+                           uint16_t numBytes)>
+    FrameHook;
+
+/**
+ * @brief Adds a node, booting now, whose clock runs 'driftPpm' parts per
+ * million fast (slow if negative)
+ *
+ * @return The node's index for selectNode()
+ */
+int addNode(int32_t driftPpm = 0);
+void selectNode(int index);
+int selectedNode();
+
+// Time passes for all nodes; nowMicros() is the selected node's local clock
+void advance(system_tick_t ms);
+void advanceMicros(uint32_t us);
+uint64_t nowMicros();
+
+void setPin(pin_t pin, bool level);
+bool getPin(pin_t pin);
+
+void meshInject(const char* event, const char* data);
+/**
+ * @brief Runs the selected node's handlers for the events other nodes
+ * published since the last call, like its system thread would
+ *
+ * Events are dropped if the node is off the network by then.
+ */
+void meshDeliver();
+uint32_t meshPublishCount();
+void setMeshReady(bool ready);
+
+void serialInput(const char* text);
+
+const char* cloudVariable(const char* name);
+
+void setFrameHook(FrameHook hook);
+void captureFrame(const uint8_t* pixels,
+                  uint16_t numBytes,
+                  const uint16_t* channelFrom,
+                  const uint16_t* channelSent,
+                  uint8_t channels,
+                  const uint8_t* lut);
+uint32_t frameCount();
+uint64_t bytesSent();
+uint64_t wireMicros();
+
+/**
+ * @brief Microseconds until every PWM sequence started on the selected node
+ * has been clocked out, 0 if none is running
+ */
+uint32_t pwmBusyMicros();
+
+void attachPinInterrupt(pin_t pin, std::function<void()> handler);
+
+}  // namespace sim
+
+// Time
+inline system_tick_t millis() {
+  return (system_tick_t) (sim::nowMicros() / 1000);
+}
+inline uint32_t micros() {
+  return (uint32_t) sim::nowMicros();
+}
+inline void delay(system_tick_t ms) {
+  sim::advance(ms);
+}
+inline void delayMicroseconds(uint32_t us) {
+  sim::advanceMicros(us);
+}
+
+// System.ticks() counts CPU cycles on the device. Here it reads the host's
+// monotonic clock in nanoseconds, to time code rather than the virtual clock.
+class SystemClass {
+ public:
+  uint32_t ticks();
+  static uint32_t ticksPerMicrosecond() {
+    return 1000;
+  }
+};
+extern SystemClass System;
+
+// Cloud variables are only registered, see sim::cloudVariable()
+class ParticleClass {
+ public:
+  bool variable(const char* name, const char* value);
+};
+extern ParticleClass Particle;
+
+// GPIO
+inline void pinMode(pin_t pin, PinMode mode) {}
+inline int32_t digitalRead(pin_t pin) {
+  return sim::getPin(pin);
+}
+inline int32_t pinReadFast(pin_t pin) {
+  return sim::getPin(pin);
+}
+inline void digitalWrite(pin_t pin, uint8_t value) {
+  sim::setPin(pin, value);
+}
+
+template <typename T>
+bool attachInterrupt(pin_t pin,
+                     void (T::*handler)(),
+                     T* instance,
+                     InterruptMode mode) {
+  sim::attachPinInterrupt(pin,
+                          [handler, instance]() { (instance->*handler)(); });
+  return true;
+}
+
+// On-board RGB LED
+class RGBClass {
+ public:
+  void control(bool enable) {}
+  void color(int r, int g, int b) {}
+};
+extern RGBClass RGB;
+
+// Mesh network
+typedef void (*EventHandler)(const char* event, const char* data);
+
+class MeshClass {
+ public:
+  void on() {}
+  void connect() {}
+  bool ready();
+  bool subscribe(const char* prefix, EventHandler handler);
+  int publish(const char* event, const char* data);
+};
+extern MeshClass Mesh;
+
+// USB serial
+class SerialClass {
+ public:
+  void begin(long baud) {}
+  int available();
+  int read();
+  size_t println(const char* text);
+  size_t printlnf(const char* format, ...);
+};
+extern SerialClass Serial;
+
+// Logging is discarded
+class Logger {
+ public:
+  explicit Logger(const char* name) {}
+  void trace(const char* format, ...) const {}
+  void info(const char* format, ...) const {}
+  void warn(const char* format, ...) const {}
+  void error(const char* format, ...) const {}
+};
+extern Logger Log;
+
+#endif /* __SIM_PARTICLE_H */
@@ -0,0 +1,376 @@
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Particle.h"
+#include "neopixel_pwm.h"
+
+SystemClass System;
+ParticleClass Particle;
+RGBClass RGB;
+MeshClass Mesh;
+SerialClass Serial;
+Logger Log("app");
+
+namespace sim {
+
+// Global virtual clock in microseconds since the first node booted
+static uint64_t clockMicros = 0;
+
+struct Subscription {
+  std::string prefix;
+  EventHandler handler;
+};
+
+struct Event {
+  std::string name;
+  std::string data;
+};
+
+// Registered cloud variables
+struct Variable {
+  std::string name;
+  const char* value;
+};
+
+/**
+ * @brief Everything one simulated device has to itself
+ */
+struct Node {
+  // Local clock: booted at 'bootMicros' on the global clock, running
+  // 'driftPpm' parts per million fast
+  uint64_t bootMicros = 0;
+  int32_t driftPpm = 0;
+
+  // Scripted pin levels and their edge interrupt handlers
+  bool pinLevels[SIM_PIN_COUNT] = {};
+  std::function<void()> pinHandlers[SIM_PIN_COUNT];
+
+  // Mesh: handlers subscribed here, and events published by other nodes
+  // that are waiting for meshDeliver()
+  std::vector<Subscription> subscriptions;
+  std::vector<Event> inbox;
+  uint32_t publishCount = 0;
+  bool meshReady = true;
+
+  std::vector<Variable> variables;
+
+  // Pending serial input
+  std::string serialBuffer;
+
+  // Frame capture
+  FrameHook frameHook;
+  uint32_t frames = 0;
+  uint64_t sent = 0;  // Pixel bytes that would have gone on the wire
+  uint64_t wire = 0;  // Microseconds the data lines were busy
+  std::vector<uint8_t> leds;  // What the strip latched so far
+
+  // PWM devices: enabled from pwmLoadSequence() to pwmRelease(), clocking
+  // out until local micros() 'seqEnd' once started
+  struct Pwm {
+    bool enabled = false;
+    bool started = false;
+    uint32_t words = 0;
+    uint32_t seqEnd = 0;
+  } pwm[PWM_DEVICES];
+};
+
+static Node* node = nullptr;  // The selected one
+
+/**
+ * @brief Every node, in the order they were added
+ *
+ * Created on first use and never destroyed: firmware objects with static
+ * storage, like a strip, use their node from their constructors and
+ * destructors, before and after this file's statics live.
+ */
+static std::vector<std::unique_ptr<Node>>& allNodes() {
+  static std::vector<std::unique_ptr<Node>>* nodes =
+      new std::vector<std::unique_ptr<Node>>;
+  return *nodes;
+}
+
+/**
+ * @brief The selected node, node 0 if there is none yet
+ */
+static Node& current() {
+  if (!node) {
+    allNodes().emplace_back(new Node);
+    node = allNodes()[0].get();
+  }
+  return *node;
+}
+
+int addNode(int32_t driftPpm) {
+  current();
+  Node* added = new Node;
+  added->bootMicros = clockMicros;
+  added->driftPpm = driftPpm;
+  allNodes().emplace_back(added);
+  return allNodes().size() - 1;
+}
+
+void selectNode(int index) {
+  current();
+  if (index >= 0 && index < (int) allNodes().size()) {
+    node = allNodes()[index].get();
+  }
+}
+
+int selectedNode() {
+  Node* selected = &current();
+  for (size_t i = 0; i < allNodes().size(); i++) {
+    if (allNodes()[i].get() == selected) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+void advance(system_tick_t ms) {
+  clockMicros += (uint64_t) ms * 1000;
+}
+
+void advanceMicros(uint32_t us) {
+  clockMicros += us;
+}
+
+uint64_t nowMicros() {
+  const Node& n = current();
+  int64_t up = clockMicros - n.bootMicros;
+  return up + up * n.driftPpm / 1000000;
+}
+
+void setPin(pin_t pin, bool level) {
+  Node& n = current();
+  if (pin >= SIM_PIN_COUNT || n.pinLevels[pin] == level) {
+    return;
+  }
+  n.pinLevels[pin] = level;
+  if (n.pinHandlers[pin]) {
+    n.pinHandlers[pin]();
+  }
+}
+
+bool getPin(pin_t pin) {
+  return pin < SIM_PIN_COUNT && current().pinLevels[pin];
+}
+
+void attachPinInterrupt(pin_t pin, std::function<void()> handler) {
+  if (pin < SIM_PIN_COUNT) {
+    current().pinHandlers[pin] = handler;
+  }
+}
+
+void meshInject(const char* event, const char* data) {
+  for (const Subscription& s : current().subscriptions) {
+    if (strncmp(event, s.prefix.c_str(), s.prefix.size()) == 0) {
+      s.handler(event, data);
+    }
+  }
+}
+
+void meshDeliver() {
+  Node& n = current();
+  std::vector<Event> events;
+  events.swap(n.inbox);
+  if (!n.meshReady) {
+    return;
+  }
+  for (const Event& e : events) {
+    meshInject(e.name.c_str(), e.data.c_str());
+  }
+}
+
+uint32_t meshPublishCount() {
+  return current().publishCount;
+}
+
+void setMeshReady(bool ready) {
+  current().meshReady = ready;
+}
+
+void serialInput(const char* text) {
+  current().serialBuffer += text;
+}
+
+const char* cloudVariable(const char* name) {
+  for (const Variable& v : current().variables) {
+    if (v.name == name) {
+      return v.value;
+    }
+  }
+  return nullptr;
+}
+
+void setFrameHook(FrameHook hook) {
+  current().frameHook = hook;
+}
+
+/**
+ * @brief Records a frame
+ *
+ * Each of the 'channels' data lines sends 'channelSent[c]' bytes starting
+ * at byte 'channelFrom[c]' of the frame, each byte mapped through the
+ * output 'lut'. The LEDs that get no data keep their colors, so the hook
+ * sees what the strip actually shows. The lines clock out in parallel at
+ * 1.25 us per bit, so the frame is on the wire for as long as the busiest
+ * line takes.
+ */
+void captureFrame(const uint8_t* pixels,
+                  uint16_t numBytes,
+                  const uint16_t* channelFrom,
+                  const uint16_t* channelSent,
+                  uint8_t channels,
+                  const uint8_t* lut) {
+  Node& n = current();
+  uint16_t longest = 0;
+  n.frames++;
+  n.leds.resize(numBytes);
+  for (uint8_t c = 0; c < channels; c++) {
+    uint16_t end = channelFrom[c] + channelSent[c];
+    for (uint16_t i = channelFrom[c]; i < end && i < numBytes; i++) {
+      n.leds[i] = lut[pixels[i]];
+    }
+    n.sent += channelSent[c];
+    if (channelSent[c] > longest) {
+      longest = channelSent[c];
+    }
+  }
+  n.wire += (uint32_t) longest * 8 * 5 / 4;
+  if (n.frameHook) {
+    n.frameHook(millis(), n.leds.data(), numBytes);
+  }
+}
+
+uint32_t frameCount() {
+  return current().frames;
+}
+
+uint64_t bytesSent() {
+  return current().sent;
+}
+
+uint64_t wireMicros() {
+  return current().wire;
+}
+
+uint32_t pwmBusyMicros() {
+  uint32_t busy = 0;
+  for (const Node::Pwm& pwm : current().pwm) {
+    int32_t left = (int32_t) (pwm.seqEnd - micros());
+    if (pwm.started && left > (int32_t) busy) {
+      busy = left;
+    }
+  }
+  return busy;
+}
+
+}  // namespace sim
+
+// The PWM devices of neopixel_pwm.h, one set per node. The pins are not
+// modelled: captureFrame() has already recorded what each line sends.
+int8_t pwmFreeDevice(uint8_t from) {
+  for (uint8_t device = from; device < PWM_DEVICES; device++) {
+    if (!sim::current().pwm[device].enabled) {
+      return device;
+    }
+  }
+  return -1;
+}
+
+void pwmLoadSequence(uint8_t device,
+                     uint8_t pin,
+                     const uint16_t* pattern,
+                     uint32_t words) {
+  (void) pin;
+  (void) pattern;
+  sim::Node::Pwm& pwm = sim::current().pwm[device];
+  pwm.enabled = true;
+  pwm.started = false;
+  pwm.words = words;
+}
+
+/**
+ * @brief Starts a loaded sequence, 1.25 us per pixel bit; the two end
+ * words only hold the line low for the latch
+ */
+void pwmStartSequence(uint8_t device) {
+  sim::Node::Pwm& pwm = sim::current().pwm[device];
+  pwm.started = true;
+  pwm.seqEnd = micros() + (pwm.words - 2) * 5 / 4;
+}
+
+bool pwmSequenceEnded(uint8_t device) {
+  const sim::Node::Pwm& pwm = sim::current().pwm[device];
+  return pwm.started && (int32_t) (micros() - pwm.seqEnd) >= 0;
+}
+
+void pwmRelease(uint8_t device) {
+  sim::Node::Pwm& pwm = sim::current().pwm[device];
+  pwm.enabled = false;
+  pwm.started = false;
+}
+
+uint32_t SystemClass::ticks() {
+  return (uint32_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+bool ParticleClass::variable(const char* name, const char* value) {
+  sim::current().variables.push_back({name, value});
+  return true;
+}
+
+bool MeshClass::ready() {
+  return sim::current().meshReady;
+}
+
+bool MeshClass::subscribe(const char* prefix, EventHandler handler) {
+  sim::current().subscriptions.push_back({prefix, handler});
+  return true;
+}
+
+// Like the real mesh, a node does not receive its own publishes, and
+// nothing goes out while the network is down. Every other node that is on
+// the network gets the event in its inbox, for sim::meshDeliver().
+int MeshClass::publish(const char* event, const char* data) {
+  sim::Node& from = sim::current();
+  if (!from.meshReady) {
+    return -1;
+  }
+  from.publishCount++;
+  for (const std::unique_ptr<sim::Node>& to : sim::allNodes()) {
+    if (to.get() != &from && to->meshReady) {
+      to->inbox.push_back({event, data ? data : ""});
+    }
+  }
+  return 0;
+}
+
+int SerialClass::available() {
+  return sim::current().serialBuffer.size();
+}
+
+int SerialClass::read() {
+  std::string& buffer = sim::current().serialBuffer;
+  if (buffer.empty()) {
+    return -1;
+  }
+  char c = buffer[0];
+  buffer.erase(0, 1);
+  return c;
+}
+size_t SerialClass::println(const char* text) {
+  return printf("%s\n", text);
+}
+
+size_t SerialClass::printlnf(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  size_t n = vprintf(format, args);
+  va_end(args);
+  return n + printf("\n");
+}
@@ -0,0 +1,106 @@
+#include <chrono>
+
+#include "ClockStateMachine.h"
+#include "FrameTrace.h"
+
+// Firmware entry points and state machine from src/main.cpp
+void setup();
+void loop();
+extern ClockStateMachine clockStateMachine;
+
+/**
+ * @brief Runs the firmware loop for a stretch of virtual time
+ *
+ * @param ms Virtual milliseconds to run, one loop() per millisecond
+ */
+static void run(system_tick_t ms) {
+  for (system_tick_t i = 0; i < ms; i++) {
+    loop();
+    sim::advance(1);
+  }
+}
+
+/**
+ * @brief Simulates a practice and prints what the firmware did
+ *
+ * Boots the clock with the mesh network still down, switches it on in
+ * manual rainbow mode, brings the mesh up 30 seconds after boot, keeps the
+ * rainbow going for an hour, then runs a full Countdown 50 session and an
+ * hour of manual red with the tenths display, and reports boot times,
+ * frames, mesh traffic, frame timing, the tenths check, loop, render and
+ * show latency on the host, and how long the simulation took in real time.
+ *
+ * Usage: pace-clock-sim [trace-file]
+ * With a trace file, every frame shown is recorded to it (see FrameTrace.h).
+ */
+int main(int argc, char* argv[]) {
+  auto wallStart = std::chrono::steady_clock::now();
+
+  trace::Writer traceWriter;
+  if (argc > 1) {
+    if (!traceWriter.open(argv[1])) {
+      fprintf(stderr, "cannot create trace %s\n", argv[1]);
+      return 1;
+    }
+    sim::setFrameHook([&traceWriter](system_tick_t now, const uint8_t* pixels,
+                                     uint16_t numBytes) {
+      traceWriter.write(now, pixels, numBytes);
+    });
+  }
+
+  // The mesh joins in the background, the clock works right away
+  sim::setMeshReady(false);
+  setup();
+  run(1000);
+
+  // Manual rainbow for an hour
+  sim::setPin(D4, HIGH);
+  sim::setPin(D7, HIGH);
+  run(29 * 1000);
+  sim::setMeshReady(true);
+  run(60 * 60 * 1000 - 29 * 1000);
+
+  // Countdown 50 session
+  sim::setPin(D4, LOW);
+  sim::setPin(D6, HIGH);
+  run(30 * 60 * 1000);
+
+  // Manual red with tenths for an hour
+  sim::serialInput("tenths on\n");
+  sim::setPin(D6, LOW);
+  sim::setPin(D5, HIGH);
+  run(60 * 60 * 1000);
+
+  // Power off
+  sim::setPin(D7, LOW);
+  run(1000);
+
+  traceWriter.close();
+
+  double wallMs = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - wallStart)
+                      .count();
+
+  char frameErrors[256];
+  clockStateMachine.formatFrameErrors(frameErrors, sizeof(frameErrors));
+  char bootTimes[64];
+  clockStateMachine.formatBootTimes(bootTimes, sizeof(bootTimes));
+  char tenthsStats[64];
+  clockStateMachine.formatTenthsStats(tenthsStats, sizeof(tenthsStats));
+  char latency[256];
+  clockStateMachine.formatLatency(latency, sizeof(latency));
+
+  printf("simulated %lu ms in %.1f ms\n", (unsigned long) millis(), wallMs);
+  printf("boot times (ms): %s\n", bootTimes);
+  printf("frames shown: %lu\n", (unsigned long) sim::frameCount());
+  printf("pixel bytes sent: %llu\n", (unsigned long long) sim::bytesSent());
+  printf("wire time: %llu us, %.1f us per frame\n",
+         (unsigned long long) sim::wireMicros(),
+         sim::frameCount() ? (double) sim::wireMicros() / sim::frameCount()
+                           : 0.0);
+  printf("mesh publishes: %lu\n", (unsigned long) sim::meshPublishCount());
+  printf("frame error histogram (ms:count): %s\n", frameErrors);
+  printf("tenths: %s\n", tenthsStats);
+  printf("latency (us, host clock): %s\n", latency);
+  return 0;
+}
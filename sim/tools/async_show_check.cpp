@@ -0,0 +1,132 @@
+#include <stdio.h>
+
+#include "neopixel.h"
+#include "neopixel_pwm.h"
+
+static const uint16_t LEDS = 176;
+static const uint32_t FRAME_US = LEDS * 3 * 8 * 5 / 4;  // 1.25 us per bit
+
+static StaticNeoPixel<LEDS, WS2812B> strip(D8);
+
+static int failures = 0;
+static int callbacks = 0;
+
+static void done() {
+  callbacks++;
+}
+
+static void check(bool ok, const char* scenario, const char* what) {
+  if (!ok) {
+    printf("FAIL %s: %s\n", scenario, what);
+    failures++;
+  }
+}
+
+/**
+ * @brief Number of PWM devices in use, the free ones being the highest
+ */
+static int devicesInUse() {
+  int8_t device = pwmFreeDevice(0);
+  return device < 0 ? PWM_DEVICES : device;
+}
+
+/**
+ * @brief Changes every pixel, so the next show sends the whole frame
+ */
+static void touch(Adafruit_NeoPixel& s) {
+  static uint8_t level = 0;
+  level++;
+  for (uint16_t i = 0; i < s.numPixels(); i++) {
+    s.setPixelColor(i, level, level, level);
+  }
+}
+
+/**
+ * @brief Checks that a frame started by showAsync() keeps 'devices' PWM
+ * devices busy for 'us' microseconds, and that the poll that sees it end
+ * releases them and runs the callback once
+ */
+static void expectFrame(const char* scenario, int devices, uint32_t us) {
+  check(strip.isBusy(), scenario, "not busy after showAsync()");
+  check(devicesInUse() == devices, scenario, "wrong number of devices");
+  check(callbacks == 0, scenario, "callback ran before the frame was out");
+  sim::advanceMicros(us - 1);
+  check(strip.isBusy(), scenario, "done before its wire time");
+  check(callbacks == 0, scenario, "callback ran before the frame was out");
+  sim::advanceMicros(1);
+  check(!strip.isBusy(), scenario, "still busy after its wire time");
+  check(callbacks == 1, scenario, "callback did not run once");
+  check(devicesInUse() == 0, scenario, "devices not released");
+  check(!strip.isBusy() && callbacks == 1, scenario,
+        "callback ran again on the next poll");
+  callbacks = 0;
+}
+
+/**
+ * @brief Drives the asynchronous show through the simulated PWM devices
+ *
+ * Usage: async-show-check
+ * Runs Adafruit_NeoPixel's nRF52 EasyDMA show path on the host: the
+ * library reaches the PWM peripheral only through the device functions of
+ * neopixel_pwm.h, which the simulator implements. Checks that showAsync()
+ * claims a device per channel and returns while the frame is clocked out,
+ * that isBusy() holds for exactly the wire time and the poll that sees the
+ * end releases the devices and runs the callback once, that show() and
+ * deleting a strip wait for a frame in flight, and that showAsync() sends
+ * synchronously when no device is free. Exits non-zero on a failure.
+ */
+int main() {
+  strip.begin();
+
+  touch(strip);
+  strip.showAsync(done);
+  expectFrame("one channel", 1, FRAME_US);
+
+  // A frame in flight is finished, callback and all, by the next show()
+  touch(strip);
+  strip.showAsync(done);
+  touch(strip);
+  strip.show();
+  check(callbacks == 1, "show() while busy", "callback did not run once");
+  check(!strip.isBusy() && devicesInUse() == 0, "show() while busy",
+        "blocking show() left the strip busy");
+  callbacks = 0;
+
+  // Only the changed prefix is sent, so the frame is shorter
+  strip.setPixelColor(9, 1, 2, 3);
+  strip.showAsync(done);
+  expectFrame("changed prefix", 1, 10 * 3 * 8 * 5 / 4);
+
+  // Two channels clock out in parallel, as long as the longer one
+  strip.addChannel(LEDS / 4, D6);
+  touch(strip);
+  strip.showAsync(done);
+  expectFrame("two channels", 2, FRAME_US * 3 / 4);
+
+  // With every device taken the frame is sent before showAsync() returns
+  for (uint8_t device = 0; device < PWM_DEVICES; device++) {
+    pwmLoadSequence(device, D7, nullptr, 2);
+  }
+  touch(strip);
+  strip.showAsync(done);
+  check(!strip.isBusy(), "no free device", "busy without a device");
+  check(callbacks == 1, "no free device", "callback did not run once");
+  for (uint8_t device = 0; device < PWM_DEVICES; device++) {
+    pwmRelease(device);
+  }
+  callbacks = 0;
+
+  // Deleting a strip waits for its frame and releases the devices
+  Adafruit_NeoPixel* heap = new Adafruit_NeoPixel(LEDS, D7);
+  heap->begin();
+  touch(*heap);
+  heap->showAsync(done);
+  check(heap->isBusy() && devicesInUse() == 1, "delete while busy",
+        "frame not started");
+  delete heap;
+  check(callbacks == 1, "delete while busy", "callback did not run once");
+  check(devicesInUse() == 0, "delete while busy", "devices not released");
+
+  printf("async show through the PWM device shim: %d failures\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "neopixel.h"
+#include "neopixel_pwm.h"
+
+static const uint16_t LEDS = 176;  // SegmentDisplay::LED_COUNT
+static const uint16_t FRAME_BYTES = LEDS * 3;
+static const int FRAMES = 20000;
+static const int ROUNDS = 7;
+
+static StaticNeoPixel<LEDS, WS2812B> strip(D8);
+static int failures = 0;
+
+/**
+ * @brief Host time of one call of 'run', in nanoseconds, the best of
+ * ROUNDS rounds
+ */
+template <typename Run>
+static double nsPerCall(Run run) {
+  double best = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < FRAMES; i++) {
+      run(i);
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (round == 0 || elapsed.count() < best) {
+      best = elapsed.count();
+    }
+  }
+  return best / FRAMES;
+}
+
+/**
+ * @brief setBrightness() as it was before the output LUT: the stored
+ * bytes are rescaled in place, 'brightness' is the stored value (b + 1)
+ */
+static void rescale(uint8_t* pixels, uint8_t& brightness, uint8_t b) {
+  uint8_t newBrightness = b + 1;
+  if (newBrightness != brightness) {
+    uint8_t oldBrightness = brightness - 1;
+    uint16_t scale;
+    if (oldBrightness == 0)
+      scale = 0;
+    else if (b == 255)
+      scale = 65535 / oldBrightness;
+    else
+      scale = (((uint16_t) newBrightness << 8) - 1) / oldBrightness;
+    for (uint16_t i = 0; i < FRAME_BYTES; i++) {
+      pixels[i] = (pixels[i] * scale) >> 8;
+    }
+    brightness = newBrightness;
+  }
+}
+
+/**
+ * @brief The nRF52 pattern encoder before the output LUT: bytes are
+ * encoded as stored
+ */
+static void encodeStored(const uint8_t* pixels, uint16_t* pattern) {
+  uint32_t pos = 0;
+  for (uint16_t n = 0; n < FRAME_BYTES; n++) {
+    for (uint8_t mask = 0x80; mask > 0; mask >>= 1) {
+      pattern[pos++] = (pixels[n] & mask) ? MAGIC_T1H : MAGIC_T0H;
+    }
+  }
+  pattern[pos++] = 0 | (0x8000);
+  pattern[pos] = 0 | (0x8000);
+}
+
+static uint32_t color(int frame, uint16_t led) {
+  return Adafruit_NeoPixel::Color(frame + led, frame * 3 + led, led * 7);
+}
+
+/**
+ * @brief Non-destructive brightness: checks and host benchmark
+ *
+ * Usage: brightness-bench
+ * Checks that the stored pixels survive a series of brightness changes
+ * exactly, while the LEDs get (c * (brightness + 1)) >> 8, and counts the
+ * bytes the in-place rescaling used before loses on the same series. Then
+ * times, for a full 176-LED frame, setPixelColor() with the per-call
+ * multiply against plain stores, the nRF52 PWM encoder on the stored bytes
+ * against mapping them through the output LUT, and a brightness change
+ * both ways. Host times only show the ratio; the Argon is a Cortex-M4 at
+ * 64 MHz. Exits non-zero if a check fails.
+ */
+int main() {
+  strip.begin();
+  std::vector<uint8_t> leds;
+  sim::setFrameHook([&leds](system_tick_t now, const uint8_t* pixels,
+                            uint16_t numBytes) {
+    leds.assign(pixels, pixels + numBytes);
+  });
+
+  srand(1);
+  uint8_t set[FRAME_BYTES];
+  for (uint16_t i = 0; i < LEDS; i++) {
+    strip.setPixelColor(i, rand() & 0xFF, rand() & 0xFF, rand() & 0xFF);
+  }
+  memcpy(set, strip.getPixels(), FRAME_BYTES);
+
+  uint8_t rescaled[FRAME_BYTES];
+  memcpy(rescaled, set, FRAME_BYTES);
+  uint8_t storedBrightness = 0;  // Full brightness, as constructed
+  const uint8_t series[] = {128, 10, 200, 3, 90, 255};
+  for (uint8_t b : series) {
+    strip.setBrightness(b);
+    strip.show();
+    rescale(rescaled, storedBrightness, b);
+
+    bool output = leds.size() == FRAME_BYTES;
+    for (uint16_t i = 0; output && i < FRAME_BYTES; i++) {
+      output = leds[i] == (uint8_t) ((set[i] * (b + 1)) >> 8);
+    }
+    if (!output) {
+      printf("FAIL brightness %u: LEDs differ from (c * (b + 1)) >> 8\n", b);
+      failures++;
+    }
+    if (memcmp(strip.getPixels(), set, FRAME_BYTES) != 0) {
+      printf("FAIL brightness %u changed the stored pixels\n", b);
+      failures++;
+    }
+  }
+  int lost = 0;
+  for (uint16_t i = 0; i < FRAME_BYTES; i++) {
+    lost += rescaled[i] != set[i];
+  }
+  printf("brightness 128, 10, 200, 3, 90, 255: stored bytes changed %d of "
+         "%u, %d with in-place rescaling\n",
+         memcmp(strip.getPixels(), set, FRAME_BYTES) ? FRAME_BYTES : 0,
+         FRAME_BYTES, lost);
+
+  // Half brightness for the timing, so both paths scale
+  uint8_t brightness = 129;
+  strip.setBrightness(128);
+  uint8_t lut[256];
+  for (int v = 0; v < 256; v++) {
+    lut[v] = (v * brightness) >> 8;
+  }
+  std::vector<uint16_t> pattern(pwmPatternWords(FRAME_BYTES));
+  volatile uint32_t sink = 0;
+
+  double setMultiply = nsPerCall([&](int frame) {
+    for (uint16_t led = 0; led < LEDS; led++) {
+      uint32_t c = color(frame, led);
+      uint8_t r = (uint8_t) (c >> 16), g = (uint8_t) (c >> 8), b = c;
+      r = (r * brightness) >> 8;
+      g = (g * brightness) >> 8;
+      b = (b * brightness) >> 8;
+      strip.setPixelColor(led, r, g, b);
+    }
+  });
+  double setPlain = nsPerCall([&](int frame) {
+    for (uint16_t led = 0; led < LEDS; led++) {
+      uint32_t c = color(frame, led);
+      strip.setPixelColor(led, (uint8_t) (c >> 16), (uint8_t) (c >> 8),
+                          (uint8_t) c);
+    }
+  });
+  const uint8_t* pixels = strip.getPixels();
+  double encodeStoredNs = nsPerCall([&](int frame) {
+    encodeStored(pixels, pattern.data());
+    sink += pattern[frame % FRAME_BYTES];
+  });
+  double encodeLutNs = nsPerCall([&](int frame) {
+    encodePwmPattern(pixels, FRAME_BYTES, lut, pattern.data());
+    sink += pattern[frame % FRAME_BYTES];
+  });
+  double rescaleNs = nsPerCall([&](int i) {
+    rescale(rescaled, storedBrightness, i & 1 ? 100 : 200);
+  });
+  double lutNs = nsPerCall([&](int i) {
+    strip.setBrightness(i & 1 ? 100 : 200);
+  });
+
+  printf("full frame, %u LEDs (ns, host):\n", LEDS);
+  printf("  setPixelColor per LED, multiply    %8.1f\n", setMultiply);
+  printf("  setPixelColor per LED, stored      %8.1f  (%.2fx)\n", setPlain,
+         setMultiply / setPlain);
+  printf("  PWM encode, stored bytes           %8.1f\n", encodeStoredNs);
+  printf("  PWM encode, through the LUT        %8.1f  (%.2fx)\n",
+         encodeLutNs, encodeStoredNs / encodeLutNs);
+  printf("  setBrightness, rescale pixels      %8.1f\n", rescaleNs);
+  printf("  setBrightness, rebuild the LUT     %8.1f  (%.2fx)\n", lutNs,
+         rescaleNs / lutNs);
+  printf("%d failures\n", failures);
+  return failures ? 1 : 0;
+}
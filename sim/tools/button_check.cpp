@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Button.h"
+
+static const pin_t PIN = D4;
+static const system_tick_t DEBOUNCE_MS = 50;  // Button::DEBOUNCE_DELAY
+
+static int failures = 0;
+
+/**
+ * @brief A Button on PIN plus what update() reported for it
+ */
+struct Switch {
+  Button button{PIN};
+  int changes = 0;              // stateJustChanged() reports
+  system_tick_t changedAt = 0;  // millis() of the last one
+  system_tick_t lastEdge = 0;   // millis() of the last pin change
+  bool polling = true;          // update() runs as time passes
+
+  Switch() {
+    sim::setPin(PIN, LOW);
+    button.begin();
+  }
+
+  ~Switch() {
+    sim::attachPinInterrupt(PIN, nullptr);
+  }
+
+  /**
+   * @brief Runs the loop for 'us' microseconds, one update() per
+   * millisecond unless polling is off
+   */
+  void run(uint32_t us) {
+    while (us > 0) {
+      uint32_t step = 1000 - (uint32_t) (sim::nowMicros() % 1000);
+      if (step > us) {
+        step = us;
+      }
+      sim::advanceMicros(step);
+      us -= step;
+      if (polling && sim::nowMicros() % 1000 == 0) {
+        update();
+      }
+    }
+  }
+
+  void update() {
+    button.update(millis());
+    if (button.stateJustChanged()) {
+      changes++;
+      changedAt = millis();
+    }
+  }
+
+  /**
+   * @brief Sets the pin level; a change fires the edge interrupt
+   */
+  void set(bool level) {
+    if (level != sim::getPin(PIN)) {
+      sim::setPin(PIN, level);
+      lastEdge = millis();
+    }
+  }
+
+  /**
+   * @brief Toggles the pin once after each of 'gapsUs', then leaves it at
+   * 'level'
+   */
+  void chatter(const uint32_t* gapsUs, int count, bool level) {
+    for (int i = 0; i < count; i++) {
+      set(!sim::getPin(PIN));
+      run(gapsUs[i]);
+    }
+    set(level);
+  }
+};
+
+static void check(bool ok, const char* scenario, const char* what) {
+  if (!ok) {
+    printf("FAIL %s: %s\n", scenario, what);
+    failures++;
+  }
+}
+
+/**
+ * @brief Checks that the switch settled on 'on' with 'changes' reports, none
+ * of them before the input was quiet for the debounce time
+ */
+static void expect(Switch& sw, const char* scenario, bool on, int changes) {
+  sw.run(2 * DEBOUNCE_MS * 1000);
+  check(sw.button.isOn() == on, scenario, "wrong final state");
+  check(sw.changes == changes, scenario, "wrong number of changes");
+  if (sw.changes) {
+    check(sw.changedAt > sw.lastEdge + DEBOUNCE_MS, scenario,
+          "changed before the input was quiet");
+  }
+}
+
+/**
+ * @brief Scripted switch bounce through Button's edge queue
+ *
+ * Usage: button-check
+ * Drives the simulated pin with clean edges, contact chatter on press and
+ * release, a short glitch, a burst of more edges than the queue holds and
+ * random chatter. Each edge goes through the pin interrupt into the queue,
+ * and update() runs once per millisecond like the loop. Checks the final
+ * debounced state, that each settled change is reported exactly once, and
+ * never before the input was quiet for the debounce time. Exits non-zero
+ * on a failure.
+ */
+int main() {
+  sim::advance(1000);
+
+  {
+    Switch sw;
+    sw.set(HIGH);
+    expect(sw, "clean press", true, 1);
+    sw.changes = 0;
+    sw.set(LOW);
+    expect(sw, "clean release", false, 1);
+  }
+  {
+    Switch sw;
+    const uint32_t gaps[] = {300, 1200, 150, 4000, 800, 2500, 90, 6000, 400};
+    sw.chatter(gaps, sizeof(gaps) / sizeof(gaps[0]), HIGH);
+    expect(sw, "press with chatter", true, 1);
+    sw.changes = 0;
+    sw.chatter(gaps, sizeof(gaps) / sizeof(gaps[0]), LOW);
+    expect(sw, "release with chatter", false, 1);
+  }
+  {
+    Switch sw;
+    sw.set(HIGH);
+    sw.run(20 * 1000);
+    sw.set(LOW);
+    expect(sw, "20 ms glitch", false, 0);
+  }
+  {
+    // Every edge lands between two updates: the queue overflows and update()
+    // falls back to reading the pin
+    Switch sw;
+    sw.polling = false;
+    const uint32_t gaps[20] = {};
+    sw.chatter(gaps, 20, HIGH);
+    sw.polling = true;
+    expect(sw, "queue overflow", true, 1);
+  }
+  {
+    Switch sw;
+    srand(1);
+    bool state = false;
+    for (int round = 0; round < 500; round++) {
+      uint32_t gaps[16];
+      int count = rand() % 16;
+      for (int i = 0; i < count; i++) {
+        gaps[i] = 50 + rand() % 8000;
+      }
+      bool level = rand() % 2;
+      sw.changes = 0;
+      sw.chatter(gaps, count, level);
+      expect(sw, "random chatter", level, level != state);
+      state = level;
+    }
+  }
+
+  printf("%d failures\n", failures);
+  return failures ? 1 : 0;
+}
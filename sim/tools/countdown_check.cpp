@@ -0,0 +1,133 @@
+#include <stdio.h>
+
+#include "ClockStateMachine.h"
+
+typedef ClockStateMachine::CountdownFrame CountdownFrame;
+
+// Rounds of 60 down to 1 seconds take 1830 s after the 30 s lead-in; from
+// then on the old loop below decrements initialTime past zero, wraps the
+// int8_t and never terminates
+static const uint32_t ITERATIVE_LIMIT_MS = (30 + 1830) * 1000;
+
+/**
+ * @brief Countdown 50 display as stateCountdown50() computed it before the
+ * closed form: rounds are walked one by one from the 60 second round
+ *
+ * Only valid before ITERATIVE_LIMIT_MS.
+ */
+static CountdownFrame iterativeFrame(uint32_t elapsedMs) {
+  CountdownFrame frame;
+  int8_t initialTime = 60;
+  int32_t elapsedSec = (elapsedMs / 1000) - 30;
+  int32_t totalSec = 0;
+
+  // Calculate current round
+  while (elapsedSec >= totalSec + initialTime) {
+    totalSec += initialTime;
+    initialTime--;
+  }
+
+  // Check if we're done
+  if (initialTime <= 20) {
+    frame.done = true;
+    return frame;
+  }
+
+  uint32_t roundElapsedSec =
+      elapsedSec < 0 ? initialTime + elapsedSec : elapsedSec - totalSec;
+  uint8_t remainingSec;
+  int r, g, b;
+  int group = 0;
+
+  // First 22 seconds: two 10-second countdowns
+  if (roundElapsedSec < (initialTime < 30 ? 12 : 22)) {
+    remainingSec = 10 - (roundElapsedSec % 10);
+
+    // Set group based on phase
+    group = (roundElapsedSec < 2) ? 1 : (roundElapsedSec < 12) ? 2 : 3;
+
+    // Color selection
+    if (remainingSec > 8) {
+      r = 255;
+      g = 0;
+      b = 0;
+      remainingSec = initialTime == 60 ? 0 : initialTime + 1;
+    } else {
+      r = (remainingSec > 6) ? 100 : (remainingSec > 3) ? 255 : 255;
+      g = (remainingSec > 6) ? 255 : (remainingSec > 3) ? 255 : 100;
+      b = 0;
+    }
+  }
+  // Normal round timing
+  else {
+    remainingSec = initialTime - (roundElapsedSec % initialTime);
+    group = (remainingSec <= 10) ? 1 : 0;
+
+    // Color selection
+    r = (remainingSec > 6) ? 100 : (remainingSec > 3) ? 255 : 255;
+    g = (remainingSec > 6) ? 255 : (remainingSec > 3) ? 255 : 100;
+    b = 0;
+  }
+
+  frame.group = group;
+  frame.remainingSec = remainingSec;
+  frame.r = r;
+  frame.g = g;
+  frame.b = b;
+  return frame;
+}
+
+static bool sameFrame(const CountdownFrame& a, const CountdownFrame& b) {
+  if (a.done || b.done) {
+    return a.done == b.done;
+  }
+  return a.group == b.group && a.remainingSec == b.remainingSec &&
+         a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+/**
+ * @brief Checks the closed-form Countdown 50 renderer against the iterative
+ * one it replaced
+ *
+ * Usage: countdown-check
+ * Compares ClockStateMachine::countdownFrame() with the old round-by-round
+ * loop on every half second from the start of the session to 50 minutes.
+ * The old loop hangs from ITERATIVE_LIMIT_MS on, long after the session
+ * ended, so from there the display must simply stay off. The dots and the
+ * final-seconds pulse are drawn from the time alone and are not part of the
+ * comparison. Exits non-zero on any difference.
+ */
+int main() {
+  const uint32_t rangeMs = 50 * 60 * 1000;
+  int failures = 0;
+  uint32_t checked = 0, lastShown = 0;
+
+  for (uint32_t ms = 0; ms <= rangeMs; ms += 500) {
+    CountdownFrame expected;
+    if (ms < ITERATIVE_LIMIT_MS) {
+      expected = iterativeFrame(ms);
+    } else {
+      expected.done = true;
+    }
+    CountdownFrame actual = ClockStateMachine::countdownFrame(ms);
+    checked++;
+    if (!expected.done) {
+      lastShown = ms;
+    }
+    if (!sameFrame(expected, actual)) {
+      if (failures++ < 10) {
+        printf("FAIL at %lu ms: expected %s %d %02u (%d,%d,%d), got %s %d "
+               "%02u (%d,%d,%d)\n",
+               (unsigned long) ms, expected.done ? "done" : "show",
+               expected.group, expected.remainingSec, expected.r, expected.g,
+               expected.b, actual.done ? "done" : "show", actual.group,
+               actual.remainingSec, actual.r, actual.g, actual.b);
+      }
+    }
+  }
+
+  printf("%lu frames checked, session shown until %lu s, %d failures\n",
+         (unsigned long) checked, (unsigned long) (lastShown / 1000),
+         failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,93 @@
+#include <stdio.h>
+
+#include <chrono>
+
+#include "SegmentDisplay.h"
+
+static const int FRAMES = 20000;
+static const int ROUNDS = 7;
+
+// Time a frame may take on the host. On the Argon a frame must draw in
+// 1 ms, a twentieth of the 20 ms animation frame, to leave the loop and
+// the mesh stack their time; a desktop core gets through the same integer
+// code at least 50 times faster than the 64 MHz Cortex-M4.
+static const double FRAME_BUDGET_NS = 20000;
+
+static StaticNeoPixel<SegmentDisplay::LED_COUNT, WS2812B> strip(D8);
+static SegmentDisplay display(strip);
+
+/**
+ * @brief Host time of one frame of 'type', in nanoseconds, the best of
+ * ROUNDS rounds
+ *
+ * Every frame shows 8 on every digit, so every segment LED is shaded, and
+ * changes the color and the effect's phase so nothing is skipped.
+ */
+static double nsPerFrame(SegmentDisplay::Effect::Type type) {
+  SegmentDisplay::Effect effect;
+  effect.type = type;
+  effect.b2 = 255;
+  effect.depth = 192;
+
+  double best = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < FRAMES; i++) {
+      effect.phase = i * 97;
+      display.setEffect(effect);
+      display.setTime(8, 8, 8, 8, 1, 255, i & 0xFF, 0);
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (round == 0 || elapsed.count() < best) {
+      best = elapsed.count();
+    }
+  }
+  return best / FRAMES;
+}
+
+/**
+ * @brief Host benchmark of the per-pixel display effects
+ *
+ * Usage: effects-bench
+ * Draws full 176-LED frames showing 88:88 through SegmentDisplay with each
+ * effect, the simulated showAsync() included, and reports the time per
+ * frame and per LED against the solid color the display was limited to
+ * before effects. Host times only show the ratio; the Argon is a Cortex-M4
+ * at 64 MHz. Exits non-zero if an effect takes more than FRAME_BUDGET_NS
+ * per frame, or if a frame was skipped.
+ */
+int main() {
+  strip.begin();
+
+  struct {
+    const char* name;
+    SegmentDisplay::Effect::Type type;
+  } effects[] = {
+      {"solid", SegmentDisplay::Effect::SOLID},
+      {"gradient", SegmentDisplay::Effect::GRADIENT},
+      {"chase", SegmentDisplay::Effect::CHASE},
+      {"pulse", SegmentDisplay::Effect::PULSE},
+  };
+
+  int failures = 0;
+  double solid = 0;
+  printf("full frame 88:88, %u LEDs (ns, host), budget %.0f:\n",
+         SegmentDisplay::LED_COUNT, FRAME_BUDGET_NS);
+  for (const auto& effect : effects) {
+    uint32_t skipped = display.getFramesSkipped();
+    double ns = nsPerFrame(effect.type);
+    bool ok = ns <= FRAME_BUDGET_NS && display.getFramesSkipped() == skipped;
+    if (effect.type == SegmentDisplay::Effect::SOLID) {
+      solid = ns;
+    }
+    printf("  %-8s %8.1f per frame %6.2f per LED  (%.2fx solid)%s\n",
+           effect.name, ns, ns / SegmentDisplay::LED_COUNT, ns / solid,
+           ok ? "" : "  FAIL");
+    if (!ok) {
+      failures++;
+    }
+  }
+  printf("%d failures\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,211 @@
+#include <math.h>
+#include <stdio.h>
+
+#include <chrono>
+
+#include "HueWheel.h"
+
+static const int COLORS = 4096;
+static const int ROUNDS = 7;
+
+// Largest channel difference toRgb() may have from the OKLab reference.
+// The table entries are exact to rounding, but blending their RGB is linear
+// where the OKLab hue is not: next to the primaries, where an entry and the
+// next lie on both sides of a corner of the RGB cube, the blend is off by up
+// to 33 steps for a few hue units.
+static const int MAX_DELTA = 33;
+
+static int failures = 0;
+
+/**
+ * @brief OKLab hue angle of an sRGB color with channels in 0-1
+ */
+static double oklabHue(double r, double g, double b) {
+  double c[3] = {r, g, b};
+  for (double& v : c) {
+    v = v <= 0.04045 ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4);
+  }
+  double l = cbrt(0.4122214708 * c[0] + 0.5363325363 * c[1] +
+                  0.0514459929 * c[2]);
+  double m = cbrt(0.2119034982 * c[0] + 0.6806995451 * c[1] +
+                  0.1073969566 * c[2]);
+  double s = cbrt(0.0883024619 * c[0] + 0.2817188376 * c[1] +
+                  0.6299787005 * c[2]);
+  double a = 1.9779984951 * l - 2.4285922050 * m + 0.4505937099 * s;
+  double bb = 0.0259040371 * l + 0.7827717662 * m - 0.8086757660 * s;
+  return atan2(bb, a);
+}
+
+/**
+ * @brief Fully saturated color at 'degrees' on the HSV wheel, channels in
+ * 0-1
+ */
+static void hsv(double degrees, double rgb[3]) {
+  degrees = fmod(degrees + 360, 360);
+  int sector = (int) (degrees / 60);
+  double f = degrees / 60 - sector;
+  const double colors[6][3] = {{1, f, 0},     {1 - f, 1, 0}, {0, 1, f},
+                               {0, 1 - f, 1}, {f, 0, 1},     {1, 0, 1 - f}};
+  for (int i = 0; i < 3; i++) {
+    rgb[i] = colors[sector][i];
+  }
+}
+
+/**
+ * @brief OKLab hue angle the wheel has turned through from green, 'u'
+ * degrees along the HSV wheel towards yellow
+ */
+static double turned(double u) {
+  static double green = oklabHue(0, 1, 0);
+  double rgb[3];
+  hsv(120 - u, rgb);
+  double angle = fmod(green - oklabHue(rgb[0], rgb[1], rgb[2]), 2 * M_PI);
+  return angle < 0 ? angle + 2 * M_PI : angle;
+}
+
+/**
+ * @brief The color HueWheel stands for, in floating point: the fully
+ * saturated color at an OKLab hue angle of 'hue' FULL_TURN units from green
+ */
+static void reference(uint16_t hue, double rgb[3]) {
+  double target = 2 * M_PI * hue / HueWheel::FULL_TURN;
+  double lo = 0, hi = 360;
+  for (int i = 0; hue && i < 50; i++) {
+    double mid = (lo + hi) / 2;
+    (turned(mid) < target ? lo : hi) = mid;
+  }
+  hsv(120 - lo, rgb);
+  for (int i = 0; i < 3; i++) {
+    rgb[i] *= 255;
+  }
+}
+
+/**
+ * @brief Largest difference of a channel of 'r', 'g', 'b' from 'rgb'
+ */
+static double delta(int r, int g, int b, const double rgb[3]) {
+  double d = fmax(fabs(r - rgb[0]), fabs(g - rgb[1]));
+  return fmax(d, fabs(b - rgb[2]));
+}
+
+/**
+ * @brief The manual rainbow's color before HueWheel, from whole seconds
+ */
+static void floatWheel(uint32_t elapsedMs, int& r, int& g, int& b) {
+  uint32_t elapsedSec = elapsedMs / 1000;
+  uint8_t pos = (elapsedSec % 240) * 1.0625;  // 255/240 ≈ 1.0625
+  if (pos < 85) {
+    r = pos * 3;
+    g = 255 - pos * 3;
+    b = 0;
+  } else if (pos < 170) {
+    pos -= 85;
+    r = 255 - pos * 3;
+    g = 0;
+    b = pos * 3;
+  } else {
+    pos -= 170;
+    r = 0;
+    g = pos * 3;
+    b = 255 - pos * 3;
+  }
+}
+
+/**
+ * @brief Host time of one call of 'run', in nanoseconds, the best of
+ * ROUNDS rounds of 'calls' calls
+ */
+template <typename Run>
+static double nsPerCall(int calls, Run run) {
+  double best = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; i++) {
+      run(i);
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (round == 0 || elapsed.count() < best) {
+      best = elapsed.count();
+    }
+  }
+  return best / calls;
+}
+
+/**
+ * @brief Checks the fixed-point hue wheel against OKLab and times it on the
+ * host
+ *
+ * Usage: hue-check
+ * Computes, for every one of the 65536 hues, the color at that OKLab hue
+ * angle in floating point and compares it with HueWheel::toRgb(): each of
+ * the 256 table entries must round to the reference, and no channel of a
+ * blended hue may be further than MAX_DELTA off. Then times the color of a
+ * 20 ms rainbow frame with HueWheel, with the float wheel it replaced, and
+ * with the float reference. Host times only show the ratio; the Argon is a
+ * Cortex-M4 at 64 MHz, with no double-precision FPU for the float wheel's
+ * 1.0625 or the reference. Exits non-zero on a color outside the bounds.
+ */
+int main() {
+  double worst = 0, total = 0, worstEntry = 0;
+  uint16_t worstHue = 0;
+  for (uint32_t hue = 0; hue < HueWheel::FULL_TURN; hue++) {
+    double rgb[3];
+    reference(hue, rgb);
+    int r, g, b;
+    HueWheel::toRgb(hue, r, g, b);
+    double d = delta(r, g, b, rgb);
+    total += d;
+    if (d > worst) {
+      worst = d;
+      worstHue = hue;
+    }
+    if ((hue & 0xFF) == 0 && d > worstEntry) {
+      worstEntry = d;
+    }
+  }
+  if (worstEntry > 0.5 + 1e-6) {
+    printf("FAIL table entry %.2f off the reference\n", worstEntry);
+    failures++;
+  }
+  if (worst > MAX_DELTA) {
+    printf("FAIL hue %u %.2f off the reference\n", worstHue, worst);
+    failures++;
+  }
+  double rgb[3];
+  int r, g, b;
+  reference(worstHue, rgb);
+  HueWheel::toRgb(worstHue, r, g, b);
+  printf("65536 hues against OKLab: table entries up to %.2f off, blends "
+         "up to %.2f (hue %u: %d,%d,%d for %.1f,%.1f,%.1f), %.2f on "
+         "average\n",
+         worstEntry, worst, worstHue, r, g, b, rgb[0], rgb[1], rgb[2],
+         total / HueWheel::FULL_TURN);
+
+  const uint32_t PERIOD_MS = 240000;
+  volatile uint32_t sink = 0;
+  double fixed = nsPerCall(COLORS * 16, [&](int i) {
+    int r, g, b;
+    HueWheel::toRgb(HueWheel::fromTime(i * 20, PERIOD_MS), r, g, b);
+    sink += r + g + b;
+  });
+  double wheel = nsPerCall(COLORS * 16, [&](int i) {
+    int r, g, b;
+    floatWheel(i * 20, r, g, b);
+    sink += r + g + b;
+  });
+  double oklab = nsPerCall(COLORS / 16, [&](int i) {
+    double rgb[3];
+    reference(HueWheel::fromTime(i * 20, PERIOD_MS), rgb);
+    sink += rgb[0] + rgb[1] + rgb[2];
+  });
+
+  printf("color per frame (ns, host):\n");
+  printf("  HueWheel, fixed point          %10.1f\n", fixed);
+  printf("  float wheel, whole seconds     %10.1f  (%.2fx)\n", wheel,
+         wheel / fixed);
+  printf("  float OKLab reference          %10.1f  (%.0fx)\n", oklab,
+         oklab / fixed);
+  printf("%d failures\n", failures);
+  return failures ? 1 : 0;
+}
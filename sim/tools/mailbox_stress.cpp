@@ -0,0 +1,122 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <thread>
+
+#include "Mailbox.h"
+
+static const uint32_t POSTS = 1000000;
+static const int WORDS = 30;
+
+/**
+ * @brief A value that can tell whether it was copied whole
+ *
+ * Every word is derived from the sequence number, so a value mixed from two
+ * posts does not check out. Copying gives up the CPU halfway at random, so
+ * the other thread gets to run in the middle of post() and take(), in
+ * varying interleavings, even on a single core.
+ */
+struct Frame {
+  uint32_t seq;
+  uint32_t words[WORDS];
+
+  Frame() = default;
+  Frame(const Frame&) = delete;
+
+  Frame& operator=(const Frame& other) {
+    seq = other.seq;
+    memcpy(words, other.words, sizeof(words) / 2);
+    static thread_local uint32_t random = 1;
+    random = random * 1103515245u + 12345;
+    if (random & 0x10000) {
+      std::this_thread::yield();
+    }
+    memcpy(words + WORDS / 2, other.words + WORDS / 2, sizeof(words) / 2);
+    return *this;
+  }
+
+  void fill(uint32_t n) {
+    seq = n;
+    for (int i = 0; i < WORDS; i++) {
+      words[i] = n * 2654435761u + i;
+    }
+  }
+
+  bool whole() const {
+    for (int i = 0; i < WORDS; i++) {
+      if (words[i] != seq * 2654435761u + i) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+/**
+ * @brief Two-thread stress test of Mailbox
+ *
+ * Usage: mailbox-stress
+ * One std::thread posts POSTS numbered frames as fast as it can while a
+ * second one takes them. Every frame taken must be whole (not torn between
+ * two posts) and newer than the one before (never stale or repeated), and
+ * once the producer is done the last frame posted must be delivered. Exits
+ * non-zero on a failure. Build with -fsanitize=thread to also check for
+ * data races.
+ */
+int main() {
+  Mailbox<Frame> mailbox;
+  std::atomic<bool> started{false};
+  std::atomic<bool> done{false};
+
+  std::thread producer([&]() {
+    while (!started.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+    Frame frame;
+    for (uint32_t n = 1; n <= POSTS; n++) {
+      frame.fill(n);
+      mailbox.post(frame);
+    }
+    done.store(true, std::memory_order_release);
+  });
+
+  uint32_t taken = 0, torn = 0, stale = 0, last = 0;
+  std::thread consumer([&]() {
+    Frame frame;
+    started.store(true, std::memory_order_release);
+    for (;;) {
+      // Read 'done' first: once set, a take() that finds nothing new means
+      // the last post has already been taken
+      bool finished = done.load(std::memory_order_acquire);
+      if (!mailbox.take(frame)) {
+        if (finished) {
+          return;
+        }
+        std::this_thread::yield();
+        continue;
+      }
+      taken++;
+      if (!frame.whole()) {
+        torn++;
+      }
+      if (frame.seq <= last) {
+        stale++;
+      }
+      last = frame.seq;
+    }
+  });
+
+  producer.join();
+  consumer.join();
+
+  printf("%lu posted, %lu taken, %lu torn, %lu stale, last %lu\n",
+         (unsigned long) POSTS, (unsigned long) taken, (unsigned long) torn,
+         (unsigned long) stale, (unsigned long) last);
+  bool ok = taken > 0 && torn == 0 && stale == 0 && last == POSTS;
+  if (!ok) {
+    printf("FAIL\n");
+  }
+  return ok ? 0 : 1;
+}
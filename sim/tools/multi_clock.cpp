@@ -0,0 +1,237 @@
+#include <stdio.h>
+
+#include <deque>
+#include <vector>
+
+#include "ClockStateMachine.h"
+
+// Followers run fast and slow against the leader, about as far apart as
+// two crystal oscillators get over the temperature range
+static const int32_t DRIFT = 150;
+static const int32_t DRIFT_PPM[] = {DRIFT, -DRIFT};
+
+// Leaders send a heartbeat every minute, and followers give up on a silent
+// leader after 3 of them
+static const system_tick_t HEARTBEAT_MS = 60000;
+static const system_tick_t SYNC_TIMEOUT_MS = 3 * HEARTBEAT_MS;
+
+// How far behind or ahead of the leader a follower may run: the drift
+// since the last sync, plus a loop, plus a millisecond for the elapsed time
+// in the sync, which both clocks' millis() round down
+static const int32_t MAX_SKEW_MS = HEARTBEAT_MS * DRIFT / 1000000 + 2;
+static const int32_t LOST_SKEW_MS = SYNC_TIMEOUT_MS * DRIFT / 1000000 + 2;
+
+// Milliseconds of LEDs each clock remembers, so a follower's display can be
+// looked up LOST_SKEW_MS before and after in the leader's
+static const size_t HISTORY_MS = 2 * LOST_SKEW_MS + 1;
+
+static int failures = 0;
+
+/**
+ * @brief One simulated clock: its node, firmware and what its LEDs show
+ */
+struct Clock {
+  int node;
+  ClockStateMachine firmware;
+  std::vector<uint8_t> leds;
+  std::deque<std::vector<uint8_t>> shown;  // 'leds' of the last HISTORY_MS
+
+  explicit Clock(int node) : node(node) {
+    select();
+    firmware.setup();
+    sim::setFrameHook([this](system_tick_t now, const uint8_t* pixels,
+                             uint16_t numBytes) {
+      leds.assign(pixels, pixels + numBytes);
+    });
+  }
+
+  /**
+   * @brief Makes the HAL and the mesh handlers act on this clock
+   */
+  void select() {
+    sim::selectNode(node);
+    ClockStateMachine::instance = &firmware;
+  }
+
+  void record() {
+    shown.push_back(leds);
+    if (shown.size() > HISTORY_MS) {
+      shown.pop_front();
+    }
+  }
+
+  bool dark() const {
+    for (uint8_t level : leds) {
+      if (level) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+static Clock* leader;
+static std::vector<Clock*> followers;
+
+/**
+ * @brief Runs every clock for one millisecond: mesh events first, like the
+ * system thread, then the loop
+ */
+static void step() {
+  leader->select();
+  sim::meshDeliver();
+  leader->firmware.loop();
+  leader->record();
+  for (Clock* follower : followers) {
+    follower->select();
+    sim::meshDeliver();
+    follower->firmware.loop();
+    follower->record();
+  }
+  sim::advance(1);
+}
+
+/**
+ * @brief How far the follower's display LOST_SKEW_MS ago is from the
+ * leader's: the nearest offset, up to 'maxSkewMs', at which the leader
+ * showed the same
+ *
+ * @return Offset in milliseconds, -1 if there is none
+ */
+static int32_t skew(const Clock& follower, int32_t maxSkewMs) {
+  if (follower.shown.size() < HISTORY_MS ||
+      leader->shown.size() < HISTORY_MS) {
+    return 0;
+  }
+  const std::vector<uint8_t>& leds = follower.shown[LOST_SKEW_MS];
+  for (int32_t offset = 0; offset <= maxSkewMs; offset++) {
+    if (leader->shown[LOST_SKEW_MS - offset] == leds ||
+        leader->shown[LOST_SKEW_MS + offset] == leds) {
+      return offset;
+    }
+  }
+  return -1;
+}
+
+enum Expect {
+  FOLLOW,  // Followers show what the leader shows
+  DARK,    // Followers are off
+};
+
+/**
+ * @brief Runs a phase of the scenario and checks the followers' displays
+ * on every millisecond after the first 'settleMs'
+ *
+ * With FOLLOW, each follower must show what the leader showed at most
+ * 'maxSkewMs' earlier or later, as its drifted clock is a few milliseconds
+ * off; with DARK it must be off.
+ */
+static void run(const char* phase,
+                system_tick_t ms,
+                Expect expect,
+                system_tick_t settleMs = 0,
+                int32_t maxSkewMs = MAX_SKEW_MS) {
+  std::vector<uint32_t> same(followers.size()), bad(followers.size());
+  std::vector<int32_t> maxSkew(followers.size());
+  for (system_tick_t t = 0; t < ms; t++) {
+    step();
+    if (t < settleMs) {
+      continue;
+    }
+    for (size_t i = 0; i < followers.size(); i++) {
+      if (expect == DARK) {
+        followers[i]->dark() ? same[i]++ : bad[i]++;
+        continue;
+      }
+      int32_t offset = skew(*followers[i], maxSkewMs);
+      if (offset < 0) {
+        bad[i]++;
+      } else if (offset == 0) {
+        same[i]++;
+      } else if (offset > maxSkew[i]) {
+        maxSkew[i] = offset;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < followers.size(); i++) {
+    uint32_t checked = ms - settleMs;
+    if (expect == DARK) {
+      printf("%-14s follower %d: %5.1f%% dark%s\n", phase, (int) i + 1,
+             100.0 * same[i] / checked, bad[i] ? "  FAIL" : "");
+    } else {
+      printf("%-14s follower %d: %5.1f%% same time, skew up to %ld ms, "
+             "%lu ms apart%s\n",
+             phase, (int) i + 1, 100.0 * same[i] / checked, (long) maxSkew[i],
+             (unsigned long) bad[i], bad[i] ? "  FAIL" : "");
+    }
+    if (bad[i]) {
+      failures++;
+    }
+  }
+}
+
+static void setSwitch(pin_t pin, bool on) {
+  leader->select();
+  sim::setPin(pin, on);
+}
+
+static void leaderCommand(const char* line) {
+  leader->select();
+  sim::serialInput(line);
+}
+
+/**
+ * @brief Leader and followers over the simulated mesh
+ *
+ * Usage: multi-clock
+ * Boots a leading clock and a follower, switches the leader on, boots a
+ * second follower that joins while the leader is running, and runs through
+ * rainbow, red, red with the chase effect, red with tenths and Countdown 50
+ * with the followers' clocks drifting 150 ppm fast and slow. Then the
+ * leader drops off the mesh: the followers keep counting on their own until
+ * the sync timeout and go dark, and pick the leader up again at its next
+ * heartbeat once it is back. Finally the leader is switched off. Every
+ * millisecond, the LEDs of each follower are looked up in what the leader
+ * showed around that time (see run()). Exits non-zero on a failure.
+ */
+int main() {
+  leader = new Clock(0);
+  followers.push_back(new Clock(sim::addNode(DRIFT_PPM[0])));
+  run("boot", 2000, DARK, 1000);
+
+  setSwitch(D7, HIGH);
+  run("rainbow", 60000, FOLLOW);
+
+  followers.push_back(new Clock(sim::addNode(DRIFT_PPM[1])));
+  run("second joins", 10 * 60000, FOLLOW, 100);
+
+  setSwitch(D5, HIGH);
+  run("red", 10 * 60000, FOLLOW);
+  leaderCommand("effect chase\n");
+  run("red, chase", 10 * 60000, FOLLOW);
+  leaderCommand("effect solid\n");
+  leaderCommand("tenths on\n");
+  run("red, tenths", 10 * 60000, FOLLOW);
+  leaderCommand("tenths off\n");
+  setSwitch(D5, LOW);
+  setSwitch(D6, HIGH);
+  run("countdown 50", 20 * 60000, FOLLOW);
+
+  leader->select();
+  sim::setMeshReady(false);
+  // The last sync can be up to a heartbeat old: followers keep going for
+  // at least the rest of the timeout, and are dark once all of it passed
+  run("leader lost", SYNC_TIMEOUT_MS - HEARTBEAT_MS - 5000, FOLLOW, 0,
+      LOST_SKEW_MS);
+  run("sync timeout", HEARTBEAT_MS + 20000, DARK, HEARTBEAT_MS + 6000);
+  leader->select();
+  sim::setMeshReady(true);
+  run("leader back", 5 * 60000, FOLLOW, 100);
+
+  setSwitch(D7, LOW);
+  run("leader off", 10000, DARK, 100);
+
+  printf("%d failures\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "../../lib/neopixel/src/neopixel_pwm.h"
+
+// Marks pattern words nothing should have written
+static const uint16_t UNWRITTEN = 0xDEAD;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, int length) {
+  if (!ok) {
+    printf("FAIL %s (%d bytes)\n", what, length);
+    failures++;
+  }
+}
+
+/**
+ * @brief The nRF52 pattern encoding as show() did it per frame before the
+ * pattern buffer was preallocated
+ *
+ * Brightness was applied to the pixel buffer when colors were set, so the
+ * bytes are encoded as is. The end words were written with a pre-increment,
+ * one word later than the sequence plays them: word numBytes * 8 was left
+ * as malloc() returned it and the second end word landed one past the
+ * buffer. 'pattern' must hold numBytes * 8 + 3 words.
+ */
+static void encodePerFrame(const uint8_t* pixels,
+                           uint16_t numBytes,
+                           uint16_t* pattern) {
+  uint16_t pos = 0;  // bit position
+
+  for (uint16_t n = 0; n < numBytes; n++) {
+    uint8_t pix = pixels[n];
+
+    for (uint8_t mask = 0x80, i = 0; mask > 0; mask >>= 1, i++) {
+      pattern[pos] = (pix & mask) ? MAGIC_T1H : MAGIC_T0H;
+      pos++;
+    }
+  }
+
+  // Zero padding to indicate the end of que sequence
+  pattern[++pos] = 0 | (0x8000);  // Seq end
+  pattern[++pos] = 0 | (0x8000);  // Seq end
+}
+
+/**
+ * @brief Checks one frame against the per-frame encoder, bit for bit
+ *
+ * The pixel words must match exactly. The two end words must both be in
+ * the sequence, right after the pixel data, and nothing may be written
+ * past pwmPatternWords().
+ */
+static void checkFrame(const std::vector<uint8_t>& pixels,
+                       const uint8_t* lut) {
+  uint16_t numBytes = pixels.size();
+  uint32_t words = pwmPatternWords(numBytes);
+
+  // Brightness used to be applied to the pixel buffer itself
+  std::vector<uint8_t> scaled(numBytes);
+  for (uint16_t i = 0; i < numBytes; i++) {
+    scaled[i] = lut[pixels[i]];
+  }
+  std::vector<uint16_t> expected(words + 1, UNWRITTEN);
+  encodePerFrame(scaled.data(), numBytes, expected.data());
+
+  std::vector<uint16_t> actual(words + 1, UNWRITTEN);
+  encodePwmPattern(pixels.data(), numBytes, lut, actual.data());
+
+  check(memcmp(expected.data(), actual.data(),
+               numBytes * 8 * sizeof(uint16_t)) == 0,
+        "pixel words differ from the per-frame encoder", numBytes);
+  check(actual[numBytes * 8] == 0x8000 && actual[numBytes * 8 + 1] == 0x8000,
+        "end words not right after the pixel data", numBytes);
+  check(actual[words] == UNWRITTEN, "wrote past the pattern", numBytes);
+}
+
+/**
+ * @brief Checks that channels are encoded back to back, each region the
+ * same as encoding the channel's bytes on their own
+ */
+static void checkChannels(const std::vector<uint8_t>& pixels,
+                          const uint8_t* lut) {
+  uint16_t numBytes = pixels.size();
+  uint16_t from[3] = {0, (uint16_t) (numBytes / 3), (uint16_t) (numBytes / 2)};
+  uint16_t bytes[3] = {from[1], 0, (uint16_t) (numBytes - from[2])};
+
+  std::vector<uint16_t> actual(pwmPatternWords(numBytes) * 3, UNWRITTEN);
+  uint32_t words = encodePwmChannels(pixels.data(), from, bytes, 3, lut,
+                                     actual.data());
+  uint32_t expectedWords = 0;
+  for (int c = 0; c < 3; c++) {
+    expectedWords += bytes[c] ? pwmPatternWords(bytes[c]) : 0;
+  }
+  check(words == expectedWords, "channel pattern size", numBytes);
+  check(actual[words] == UNWRITTEN, "channels wrote past the pattern",
+        numBytes);
+
+  uint32_t offset = 0;
+  for (int c = 0; c < 3; c++) {
+    if (bytes[c] == 0) {
+      continue;
+    }
+    std::vector<uint16_t> expected(pwmPatternWords(bytes[c]));
+    encodePwmPattern(pixels.data() + from[c], bytes[c], lut, expected.data());
+    check(memcmp(expected.data(), actual.data() + offset,
+                 expected.size() * sizeof(uint16_t)) == 0,
+          "channel region differs", numBytes);
+    offset += expected.size();
+  }
+
+  // A single channel is the whole strip, as before channels existed
+  uint16_t allFrom = 0;
+  std::vector<uint16_t> single(pwmPatternWords(numBytes));
+  std::vector<uint16_t> whole(pwmPatternWords(numBytes));
+  encodePwmChannels(pixels.data(), &allFrom, &numBytes, 1, lut, single.data());
+  encodePwmPattern(pixels.data(), numBytes, lut, whole.data());
+  check(single == whole, "single channel differs", numBytes);
+}
+
+/**
+ * @brief Checks the nRF52 EasyDMA pattern encoding on the host
+ *
+ * Usage: pwm-pattern-check
+ * Encodes random frames of every length up to the clock's 528 bytes, with
+ * an identity LUT, brightness scaling and a random LUT, and compares the
+ * pattern words with the per-frame encoder show() used before. Exits
+ * non-zero on any difference.
+ */
+int main() {
+  srand(1);
+
+  uint8_t luts[3][256];
+  for (int v = 0; v < 256; v++) {
+    luts[0][v] = v;
+    luts[1][v] = (v * 65) >> 8;  // setBrightness(64) stores 65, no gamma
+    luts[2][v] = rand();
+  }
+
+  unsigned long frames = 0;
+  for (int numBytes = 1; numBytes <= 528; numBytes++) {
+    std::vector<uint8_t> pixels(numBytes);
+    for (uint8_t& p : pixels) {
+      p = rand();
+    }
+    for (const uint8_t* lut : luts) {
+      checkFrame(pixels, lut);
+      checkChannels(pixels, lut);
+      frames++;
+    }
+  }
+
+  printf("%lu frames checked, %d failures\n", frames, failures);
+  return failures ? 1 : 0;
+}
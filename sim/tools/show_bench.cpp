@@ -0,0 +1,74 @@
+#include <stdio.h>
+
+#include "ClockStateMachine.h"
+
+static const system_tick_t PHASE_MS = 10 * 60000;
+
+// A WS2812 bit takes 1.25 us on the wire
+static const uint32_t FRAME_BYTES = SegmentDisplay::LED_COUNT * 3;
+static const double FULL_FRAME_US = FRAME_BYTES * 8 * 1.25;
+
+static ClockStateMachine firmware;
+static int failures = 0;
+
+/**
+ * @brief Runs the firmware for 'ms' and prints what show() sent per frame
+ *
+ * Fails if every frame was sent whole.
+ */
+static void run(const char* mode, system_tick_t ms) {
+  uint32_t frames = sim::frameCount();
+  uint64_t bytes = sim::bytesSent();
+  uint64_t wire = sim::wireMicros();
+  for (system_tick_t t = 0; t < ms; t++) {
+    firmware.loop();
+    sim::advance(1);
+  }
+  frames = sim::frameCount() - frames;
+  bytes = sim::bytesSent() - bytes;
+  wire = sim::wireMicros() - wire;
+
+  double bytesPerFrame = frames ? (double) bytes / frames : 0;
+  double wirePerFrame = frames ? (double) wire / frames : 0;
+  bool ok = frames && bytes < (uint64_t) frames * FRAME_BYTES;
+  printf("  %-16s %6lu %8.1f %10.1f  %5.1f%%%s\n", mode,
+         (unsigned long) frames, bytesPerFrame, wirePerFrame,
+         100 * wirePerFrame / FULL_FRAME_US, ok ? "" : "  FAIL");
+  if (!ok) {
+    failures++;
+  }
+}
+
+/**
+ * @brief Wire time of show() with the changed prefix in each mode
+ *
+ * Usage: show-bench
+ * Runs the firmware for 10 minutes in each mode and reports how many bytes
+ * show() clocked out per frame, and for how long, against the whole
+ * 528-byte strip it sent before: 5280 us, during which the bit-bang path
+ * also keeps interrupts off. Build with -DPACE_CLOCK_SPLIT_STRIP for the
+ * strip split across three data lines, where the time is that of the
+ * busiest line. Exits non-zero if a mode sent the whole strip every frame.
+ */
+int main() {
+  firmware.setup();
+  sim::advance(1000);
+
+  printf("show(), %u LEDs, full frame %.0f us on the wire (simulated):\n",
+         SegmentDisplay::LED_COUNT, FULL_FRAME_US);
+  printf("  mode             frames bytes/fr  wire us/fr  of full\n");
+
+  sim::setPin(D5, HIGH);
+  sim::setPin(D7, HIGH);
+  run("red MM:SS", PHASE_MS);
+  sim::serialInput("tenths on\n");
+  run("red SS.t", PHASE_MS);
+  sim::serialInput("tenths off\n");
+  sim::setPin(D5, LOW);
+  run("rainbow", PHASE_MS);
+  sim::setPin(D6, HIGH);
+  run("countdown 50", PHASE_MS);
+
+  printf("%d failures\n", failures);
+  return failures ? 1 : 0;
+}
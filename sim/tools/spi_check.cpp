@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "../../lib/neopixel/src/neopixel_spi.h"
+
+static const uint16_t FRAME_BYTES = 528;  // SegmentDisplay::LED_COUNT * 3
+static const uint16_t RESET_BYTES = 120;  // WS2812B reset pulse
+static const int FRAMES = 20000;
+static const int ROUNDS = 7;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, int length) {
+  if (!ok) {
+    printf("FAIL %s (%d bytes)\n", what, length);
+    failures++;
+  }
+}
+
+/**
+ * @brief The P2 expansion as show() did it before the nibble table
+ *
+ * Brightness was applied to the pixel buffer when colors were set, so the
+ * bytes are expanded as is, 3 bytes per pixel, into 'spiArray' after
+ * 'resetOff' bytes of reset padding.
+ */
+static void expandPerBit(const uint8_t* pixels,
+                         int numPixels,
+                         uint16_t resetOff,
+                         uint8_t* spiArray) {
+  constexpr uint8_t PIX_HI = 0b110;
+  constexpr uint8_t PIX_LO = 0b100;
+
+  for (int x = 0; x < numPixels; x++) {
+    for (int s = 0; s < 3; s++) {
+      spiArray[(x * 9) + (s * 3) + 0 + resetOff] =
+          ((0x80 & pixels[(x * 3) + s]) ? (PIX_HI << 5) : (PIX_LO << 5)) +
+          ((0x40 & pixels[(x * 3) + s]) ? (PIX_HI << 2) : (PIX_LO << 2)) +
+          ((0x20 & pixels[(x * 3) + s]) ? (0b11) : (0b10));
+      spiArray[(x * 9) + (s * 3) + 1 + resetOff] =
+          0 /* bit 7 always 0 */ +
+          ((0x10 & pixels[(x * 3) + s]) ? (PIX_HI << 4) : (PIX_LO << 4)) +
+          ((0x08 & pixels[(x * 3) + s]) ? (PIX_HI << 1) : (PIX_LO << 1)) +
+          1 /* bit 0 always 1 */;
+      spiArray[(x * 9) + (s * 3) + 2 + resetOff] =
+          ((0x04 & pixels[(x * 3) + s]) ? (0b10 << 6) : (0b00 << 6)) +
+          ((0x02 & pixels[(x * 3) + s]) ? (PIX_HI << 3) : (PIX_LO << 3)) +
+          ((0x01 & pixels[(x * 3) + s]) ? (PIX_HI) : (PIX_LO));
+    }
+  }
+}
+
+/**
+ * @brief Size of the SPI buffer for a frame of 'numBytes' pixel bytes
+ */
+static uint32_t bufferBytes(uint16_t numBytes) {
+  return (uint32_t) numBytes * SPI_BYTES_PER_BYTE + 2 * RESET_BYTES;
+}
+
+/**
+ * @brief The whole SPI buffer show() sent before: malloc'd, cleared and
+ * filled per frame
+ */
+static std::vector<uint8_t> perFrameBuffer(const std::vector<uint8_t>& pixels,
+                                           const uint8_t* lut) {
+  std::vector<uint8_t> scaled(pixels.size());
+  for (size_t i = 0; i < pixels.size(); i++) {
+    scaled[i] = lut[pixels[i]];
+  }
+  std::vector<uint8_t> buffer(bufferBytes(pixels.size()), 0);
+  expandPerBit(scaled.data(), pixels.size() / 3, RESET_BYTES, buffer.data());
+  return buffer;
+}
+
+/**
+ * @brief Host time of one call of 'run', in nanoseconds, the best of
+ * ROUNDS rounds
+ */
+template <typename Run>
+static double nsPerFrame(Run run) {
+  double best = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < FRAMES; i++) {
+      run(i);
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (round == 0 || elapsed.count() < best) {
+      best = elapsed.count();
+    }
+  }
+  return best / FRAMES;
+}
+
+/**
+ * @brief Checks and times the P2 SPI nibble table expansion on the host
+ *
+ * Usage: spi-check
+ * Expands every byte value, and random frames of every whole-pixel length
+ * up to the clock's 528 bytes with an identity LUT, brightness scaling and
+ * a random LUT, into one persistent buffer per length, the way show() does
+ * now, and compares the whole buffer, reset padding included, bit for bit
+ * with the per-bit expansion into a fresh buffer it replaced. Then times a
+ * 528-byte frame both ways. Host times only show the ratio; the P2 is a
+ * Cortex-M33 at 200 MHz. Exits non-zero on any difference.
+ */
+int main() {
+  srand(1);
+
+  uint8_t luts[3][256];
+  for (int v = 0; v < 256; v++) {
+    luts[0][v] = v;
+    luts[1][v] = (v * 65) >> 8;  // setBrightness(64) stores 65, no gamma
+    luts[2][v] = rand();
+  }
+
+  // Every byte value in every position of a pixel
+  std::vector<uint8_t> all(256 * 3);
+  for (int v = 0; v < 256; v++) {
+    all[v * 3] = v;
+    all[v * 3 + 1] = 255 - v;
+    all[v * 3 + 2] = v * 7;
+  }
+  std::vector<uint8_t> allBuffer(bufferBytes(all.size()), 0);
+  expandSpiBytes(all.data(), all.size(), luts[0], &allBuffer[RESET_BYTES]);
+  check(allBuffer == perFrameBuffer(all, luts[0]), "byte values differ",
+        all.size());
+
+  unsigned long frames = 0;
+  for (uint16_t numBytes = 3; numBytes <= FRAME_BYTES; numBytes += 3) {
+    // Zeroed once, like the persistent buffer updateLength() allocates
+    std::vector<uint8_t> buffer(bufferBytes(numBytes), 0);
+    std::vector<uint8_t> pixels(numBytes);
+    for (const uint8_t* lut : luts) {
+      for (uint8_t& p : pixels) {
+        p = rand();
+      }
+      expandSpiBytes(pixels.data(), numBytes, lut, &buffer[RESET_BYTES]);
+      check(buffer == perFrameBuffer(pixels, lut),
+            "buffer differs from the per-bit expansion", numBytes);
+      frames++;
+    }
+  }
+
+  std::vector<uint8_t> pixels(FRAME_BYTES);
+  for (uint8_t& p : pixels) {
+    p = rand();
+  }
+  std::vector<uint8_t> buffer(bufferBytes(FRAME_BYTES), 0);
+  volatile uint32_t sink = 0;
+  double table = nsPerFrame([&](int i) {
+    pixels[i % FRAME_BYTES] = i;
+    expandSpiBytes(pixels.data(), FRAME_BYTES, luts[0], &buffer[RESET_BYTES]);
+    sink += buffer[RESET_BYTES + i % FRAME_BYTES];
+  });
+  double perBit = nsPerFrame([&](int i) {
+    pixels[i % FRAME_BYTES] = i;
+    uint32_t size = bufferBytes(FRAME_BYTES);
+    uint8_t* spiArray = (uint8_t*) malloc(size);
+    memset(spiArray, 0, size);
+    expandPerBit(pixels.data(), FRAME_BYTES / 3, RESET_BYTES, spiArray);
+    sink += spiArray[RESET_BYTES + i % FRAME_BYTES];
+    free(spiArray);
+  });
+
+  printf("%lu frames checked, %d failures\n", frames, failures);
+  printf("%u-byte frame (us/frame, host): nibble table %.2f, per bit with "
+         "malloc %.2f (%.1fx)\n",
+         FRAME_BYTES, table / 1000, perBit / 1000, perBit / table);
+  return failures ? 1 : 0;
+}
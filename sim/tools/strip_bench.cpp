@@ -0,0 +1,133 @@
+#include <stdio.h>
+
+#include <chrono>
+
+#include "Particle.h"
+#include "SegmentDisplay.h"
+
+typedef SegmentDisplay::Layout Layout;
+typedef Layout::Tables LayoutTables;
+
+static const int FRAMES = 50000;
+static const int ROUNDS = 7;
+
+static StaticNeoPixel<Layout::LED_COUNT, WS2812B> strip(D8);
+
+/**
+ * @brief Host time of one call of 'paint', in nanoseconds
+ *
+ * 'paint' gets the frame number, so each frame can use different colors.
+ * The best of ROUNDS rounds is kept, which filters out the host's
+ * scheduling noise.
+ */
+template <typename Paint>
+static double nsPerFrame(Paint paint) {
+  double best = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < FRAMES; frame++) {
+      paint(frame);
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (round == 0 || elapsed.count() < best) {
+      best = elapsed.count();
+    }
+  }
+  return best / FRAMES;
+}
+
+/**
+ * @brief Color of run 'run' in frame 'frame', different for every run
+ */
+static uint32_t runColor(int frame, int run) {
+  return Adafruit_NeoPixel::Color(frame + run, frame * 3 + run, run * 7);
+}
+
+/**
+ * @brief Host microbenchmark of painting a full 176-LED frame
+ *
+ * Usage: strip-bench
+ * Paints every segment and lit separator run of the clock's layout, each in
+ * its own color: with setPixelColor() per LED, rescaling brightness on every
+ * call as updateDigit() used to; with setPixelColor() per LED now that
+ * brightness is applied on output; and with one fill() per run, compared
+ * with the per-LED writes it replaces. Host times only show the ratio; the
+ * Argon is a Cortex-M4 at 64 MHz. Exits non-zero if fill() and
+ * setPixelColor() leave different pixels.
+ */
+int main() {
+  strip.begin();
+
+  auto perPixel = [](int frame) {
+    for (uint16_t i = 0; i < LayoutTables::ALL_RUN_COUNT; i++) {
+      const SegmentRun& run = LayoutTables::ALL_RUNS[i];
+      if (run.count == 0) {
+        continue;  // Separator positions without dots
+      }
+      uint32_t c = runColor(frame, i);
+      for (uint16_t led = run.first; led < run.first + run.count; led++) {
+        strip.setPixelColor(led, (uint8_t) (c >> 16), (uint8_t) (c >> 8),
+                            (uint8_t) c);
+      }
+    }
+  };
+  // setPixelColor() as updateDigit() called it before brightness moved to
+  // the output LUT: a packed Color() per LED, rescaled on every call
+  uint8_t brightness = 129;  // setBrightness(128)
+  auto scaledPixel = [brightness](int frame) {
+    for (uint16_t i = 0; i < LayoutTables::ALL_RUN_COUNT; i++) {
+      const SegmentRun& run = LayoutTables::ALL_RUNS[i];
+      if (run.count == 0) {
+        continue;  // Separator positions without dots
+      }
+      for (uint16_t led = run.first; led < run.first + run.count; led++) {
+        uint32_t c = runColor(frame, i);
+        uint8_t r = (uint8_t) (c >> 16), g = (uint8_t) (c >> 8), b = c;
+        r = (r * brightness) >> 8;
+        g = (g * brightness) >> 8;
+        b = (b * brightness) >> 8;
+        strip.setPixelColor(led, Adafruit_NeoPixel::Color(r, g, b));
+      }
+    }
+  };
+  auto runFill = [](int frame) {
+    for (uint16_t i = 0; i < LayoutTables::ALL_RUN_COUNT; i++) {
+      const SegmentRun& run = LayoutTables::ALL_RUNS[i];
+      if (run.count == 0) {
+        continue;  // Separator positions without dots
+      }
+      strip.fill(run.first, run.count, runColor(frame, i));
+    }
+  };
+
+  uint8_t reference[Layout::LED_COUNT * 3];
+  int failures = 0;
+  for (int frame = 0; frame < 256; frame++) {
+    perPixel(frame);
+    memcpy(reference, strip.getPixels(), sizeof(reference));
+    runFill(frame);
+    if (memcmp(reference, strip.getPixels(), sizeof(reference)) != 0) {
+      printf("FAIL frame %d: fill() differs from setPixelColor()\n", frame);
+      failures++;
+      break;
+    }
+  }
+
+  uint16_t runs = 0;
+  for (uint16_t i = 0; i < LayoutTables::ALL_RUN_COUNT; i++) {
+    runs += LayoutTables::ALL_RUNS[i].count != 0;
+  }
+
+  double scaledNs = nsPerFrame(scaledPixel);
+  double pixelNs = nsPerFrame(perPixel);
+  double fillNs = nsPerFrame(runFill);
+  printf("full frame, %u LEDs in %u runs (ns/frame, host):\n",
+         Layout::LED_COUNT, runs);
+  printf("  scaled setPixelColor per LED %8.1f\n", scaledNs);
+  printf("  setPixelColor per LED        %8.1f  (%.2fx scaled)\n", pixelNs,
+         scaledNs / pixelNs);
+  printf("  fill per run                 %8.1f  (%.2fx setPixelColor)\n",
+         fillNs, pixelNs / fillNs);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "ClockStateMachine.h"
+
+static const int MESSAGES = 200000;
+static const int ROUNDS = 7;
+static const uint8_t MODES = 5;  // ClockStateMachine::Mode values 0-4
+static const uint8_t EFFECTS = 3;  // SegmentDisplay::Effect SOLID to CHASE
+static const uint8_t OPTIONS = 2 * EFFECTS;  // With and without tenths
+
+/**
+ * @brief Host time of one call of 'run', in nanoseconds
+ *
+ * 'run' gets the message number. The best of ROUNDS rounds is kept, which
+ * filters out the host's scheduling noise.
+ */
+template <typename Run>
+static double nsPerMessage(Run run) {
+  double best = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < MESSAGES; i++) {
+      run(i);
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (round == 0 || elapsed.count() < best) {
+      best = elapsed.count();
+    }
+  }
+  return best / MESSAGES;
+}
+
+/**
+ * @brief Elapsed time of message 'i', spread over the whole 32-bit range
+ */
+static uint32_t elapsedOf(int i) {
+  return (uint32_t) i * 2654435761u;
+}
+
+/**
+ * @brief Display options of message 'i': every count-up effect, with and
+ * without tenths
+ */
+static uint8_t optionsOf(int i) {
+  uint8_t options = (i / MODES) % OPTIONS;
+  return options < EFFECTS
+             ? options
+             : (options - EFFECTS) | ClockStateMachine::SYNC_OPTION_TENTHS;
+}
+
+/**
+ * @brief The text sync message sent before the binary one, "1,MODE,ELAPSED"
+ */
+static void encodeText(char* buffer, uint8_t mode, uint32_t elapsedMs) {
+  snprintf(buffer, 32, "1,%u,%lu", (unsigned) mode, (unsigned long) elapsedMs);
+}
+
+static bool decodeText(const char* data, uint8_t& mode, uint32_t& elapsedMs) {
+  unsigned int version, m;
+  unsigned long elapsed;
+  if (sscanf(data, "%u,%u,%lu", &version, &m, &elapsed) != 3 ||
+      version != 1 || m >= MODES) {
+    return false;
+  }
+  mode = m;
+  elapsedMs = elapsed;
+  return true;
+}
+
+/**
+ * @brief Host benchmark of the mesh sync message codec
+ *
+ * Usage: sync-bench
+ * Round-trips every mode and display option with elapsed times across the
+ * 32-bit range through the binary base64 codec, and the modes through the
+ * snprintf/sscanf text format it replaced, then times encoding and
+ * decoding each way. Host times only show the ratio; the Argon is a
+ * Cortex-M4 at 64 MHz. Exits non-zero if a message does not round-trip, or
+ * if a corrupted one is accepted.
+ */
+int main() {
+  int failures = 0;
+  char buffer[32];
+  for (int i = 0; i < MESSAGES; i++) {
+    uint8_t mode = i % MODES, decodedMode;
+    uint8_t options = optionsOf(i), decodedOptions;
+    uint32_t elapsed = elapsedOf(i), decodedElapsed;
+    ClockStateMachine::encodeSyncData(buffer, mode, options, elapsed);
+    if (strlen(buffer) != ClockStateMachine::SYNC_ENCODED_SIZE - 1 ||
+        !ClockStateMachine::decodeSyncData(buffer, decodedMode,
+                                           decodedOptions, decodedElapsed) ||
+        decodedMode != mode || decodedOptions != options ||
+        decodedElapsed != elapsed) {
+      printf("FAIL mode %u options %u elapsed %lu does not round-trip\n",
+             mode, options, (unsigned long) elapsed);
+      failures++;
+    }
+
+    // Flipping any one character must be caught by the alphabet or the CRC
+    buffer[i % (ClockStateMachine::SYNC_ENCODED_SIZE - 1)] ^= 0x01;
+    if (ClockStateMachine::decodeSyncData(buffer, decodedMode,
+                                          decodedOptions, decodedElapsed) &&
+        (decodedMode != mode || decodedOptions != options ||
+         decodedElapsed != elapsed)) {
+      printf("FAIL corrupted message %s accepted\n", buffer);
+      failures++;
+    }
+  }
+
+  size_t textMax = 0;
+  for (uint8_t mode = 0; mode < MODES; mode++) {
+    encodeText(buffer, mode, UINT32_MAX);
+    if (strlen(buffer) > textMax) {
+      textMax = strlen(buffer);
+    }
+  }
+
+  volatile uint32_t sink = 0;
+  char encoded[64][ClockStateMachine::SYNC_ENCODED_SIZE];
+  char text[64][32];
+  for (int i = 0; i < 64; i++) {
+    ClockStateMachine::encodeSyncData(encoded[i], i % MODES, optionsOf(i),
+                                      elapsedOf(i));
+    encodeText(text[i], i % MODES, elapsedOf(i));
+  }
+
+  double binaryEncode = nsPerMessage([&](int i) {
+    ClockStateMachine::encodeSyncData(buffer, i % MODES, optionsOf(i),
+                                      elapsedOf(i));
+    sink += buffer[0];
+  });
+  double textEncode = nsPerMessage([&](int i) {
+    encodeText(buffer, i % MODES, elapsedOf(i));
+    sink += buffer[0];
+  });
+  double binaryDecode = nsPerMessage([&](int i) {
+    uint8_t mode, options;
+    uint32_t elapsed = 0;
+    ClockStateMachine::decodeSyncData(encoded[i % 64], mode, options,
+                                      elapsed);
+    sink += elapsed;
+  });
+  double textDecode = nsPerMessage([&](int i) {
+    uint8_t mode;
+    uint32_t elapsed = 0;
+    decodeText(text[i % 64], mode, elapsed);
+    sink += elapsed;
+  });
+
+  printf("sync message, %d messages (ns/message, host):\n", MESSAGES);
+  printf("         binary    text\n");
+  printf("  encode %6.1f  %6.1f  (%.1fx)\n", binaryEncode, textEncode,
+         textEncode / binaryEncode);
+  printf("  decode %6.1f  %6.1f  (%.1fx)\n", binaryDecode, textDecode,
+         textDecode / binaryDecode);
+  printf("  size   %6u  %6u  chars, text at most\n",
+         (unsigned) ClockStateMachine::SYNC_ENCODED_SIZE - 1,
+         (unsigned) textMax);
+  printf("%d failures\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,82 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../FrameTrace.h"
+
+// Differences printed before giving up on the detail
+static const int MAX_REPORTED = 20;
+
+/**
+ * @brief Compares two frame traces frame by frame
+ *
+ * Usage: trace-diff <expected> <actual>
+ * Reports each frame whose time or pixels differ, with the first differing
+ * pixel, and exits non-zero if the traces are not identical.
+ */
+int main(int argc, char* argv[]) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s <expected> <actual>\n", argv[0]);
+    return 2;
+  }
+
+  trace::Reader expected, actual;
+  if (!expected.open(argv[1])) {
+    fprintf(stderr, "cannot read trace %s\n", argv[1]);
+    return 2;
+  }
+  if (!actual.open(argv[2])) {
+    fprintf(stderr, "cannot read trace %s\n", argv[2]);
+    return 2;
+  }
+  if (expected.frameSize() != actual.frameSize()) {
+    printf("frame size differs: %u vs %u bytes\n", expected.frameSize(),
+           actual.frameSize());
+    return 1;
+  }
+
+  unsigned long frame = 0, differences = 0;
+  uint16_t frameSize = expected.frameSize();
+  while (true) {
+    uint32_t expectedTime, actualTime;
+    const uint8_t *expectedPixels, *actualPixels;
+    bool hasExpected = expected.next(expectedTime, expectedPixels);
+    bool hasActual = actual.next(actualTime, actualPixels);
+    if (!hasExpected || !hasActual) {
+      if (hasExpected != hasActual) {
+        printf("frame %lu: %s trace ends first\n", frame,
+               hasExpected ? "actual" : "expected");
+        differences++;
+      }
+      break;
+    }
+
+    bool timeDiffers = expectedTime != actualTime;
+    bool pixelsDiffer = memcmp(expectedPixels, actualPixels, frameSize) != 0;
+    if (timeDiffers || pixelsDiffer) {
+      if (differences < MAX_REPORTED) {
+        printf("frame %lu: time %lu vs %lu ms", frame,
+               (unsigned long) expectedTime, (unsigned long) actualTime);
+        for (int i = 0; pixelsDiffer && i < frameSize; i++) {
+          if (expectedPixels[i] != actualPixels[i]) {
+            int pixel = i / trace::BYTES_PER_PIXEL;
+            const uint8_t* e = expectedPixels + pixel * trace::BYTES_PER_PIXEL;
+            const uint8_t* a = actualPixels + pixel * trace::BYTES_PER_PIXEL;
+            printf(", pixel %d %02X%02X%02X vs %02X%02X%02X", pixel, e[0],
+                   e[1], e[2], a[0], a[1], a[2]);
+            break;
+          }
+        }
+        printf("\n");
+      }
+      differences++;
+    }
+    frame++;
+  }
+
+  if (differences) {
+    printf("%lu of %lu frames differ\n", differences, frame);
+    return 1;
+  }
+  printf("%lu frames identical\n", frame);
+  return 0;
+}
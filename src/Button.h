@@ -1,6 +1,8 @@
 #ifndef __BUTTON_H
 #define __BUTTON_H
 
+#include <atomic>
+
 #include "Particle.h"
 
 /**
@@ -9,6 +11,10 @@
  * This class manages a digital input pin connected to a button or switch,
  * providing debounced state reading and change detection. It supports both
  * momentary buttons and toggle switches.
+ *
+ * After begin(), pin changes are captured by an edge interrupt that
+ * timestamps them into a small lock-free queue, and update() only runs the
+ * debounce logic over queued edges. Without begin(), update() polls the pin.
  */
 class Button {
  public:
@@ -23,6 +29,19 @@ class Button {
     pinMode(pin, INPUT_PULLDOWN);
   }
 
+  /**
+   * @brief Switches the button to interrupt-driven input
+   *
+   * Takes one reading of the pin and attaches an edge interrupt. Call once
+   * from setup(), after the system has started.
+   */
+  void begin() {
+    lastReading = pinReadFast(pin);
+    lastDebounceTime = millis();
+    attachInterrupt(pin, &Button::onEdge, this, CHANGE);
+    interruptDriven = true;
+  }
+
   /**
    * @brief Updates the button state with debouncing
    * @param now Current system time in milliseconds
@@ -30,25 +49,30 @@ class Button {
    * Should be called regularly (typically in loop()) to update the button
    * state. Implements debouncing to filter out noise and switch bounce, only
    * updating the actual state after the input has been stable for
-   * DEBOUNCE_DELAY ms.
+   * DEBOUNCE_DELAY ms. When interrupt-driven and no edges are pending, this
+   * does not touch the pin at all.
    */
   void update(system_tick_t now) {
-    bool currentlyPressed = digitalRead(pin);
+    if (interruptDriven) {
+      processEdges(now);
+    } else {
+      bool currentlyPressed = digitalRead(pin);
 
-    if (currentlyPressed != lastReading) {
-      lastDebounceTime = now;
+      if (currentlyPressed != lastReading) {
+        lastDebounceTime = now;
+      }
+      lastReading = currentlyPressed;
     }
 
-    if ((now - lastDebounceTime) > DEBOUNCE_DELAY) {
+    // Signed, since an edge can be stamped just after 'now' was taken
+    if ((int32_t) (now - lastDebounceTime) > (int32_t) DEBOUNCE_DELAY) {
       // If the button state has changed after debounce:
-      if (currentlyPressed != switchState) {
-        switchState = currentlyPressed;
+      if (lastReading != switchState) {
+        switchState = lastReading;
         // Set stateChanged flag when switch changes state
         stateChanged = true;
       }
     }
-
-    lastReading = currentlyPressed;
   }
 
   /**
@@ -74,6 +98,57 @@ class Button {
 
  private:
   static const system_tick_t DEBOUNCE_DELAY = 50;  // 50ms debounce time
+  static const uint8_t EDGE_QUEUE_SIZE = 8;        // Holds size - 1 edges
+
+  /**
+   * @brief Edge interrupt handler
+   */
+  void onEdge() {
+    recordEdge(pinReadFast(pin), millis());
+  }
+
+  /**
+   * @brief Queues a pin change for the next update()
+   * @param level Pin level after the change
+   * @param time System time of the change in milliseconds
+   *
+   * Called from the edge interrupt. Safe with one producer and update() as
+   * the only consumer. If the queue is full the edge is dropped and update()
+   * re-reads the pin.
+   */
+  void recordEdge(bool level, system_tick_t time) {
+    uint8_t head = edgeHead.load(std::memory_order_relaxed);
+    uint8_t next = (head + 1) % EDGE_QUEUE_SIZE;
+    if (next == edgeTail.load(std::memory_order_acquire)) {
+      edgeOverflow.store(true, std::memory_order_release);
+      return;
+    }
+    edges[head].level = level;
+    edges[head].time = time;
+    edgeHead.store(next, std::memory_order_release);
+  }
+
+  /**
+   * @brief Applies queued edges to the debounce state
+   * @param now Current system time in milliseconds
+   *
+   * Every edge restarts the debounce timer, even one that lands on the level
+   * already seen, since it means the input is still bouncing.
+   */
+  void processEdges(system_tick_t now) {
+    if (edgeOverflow.exchange(false, std::memory_order_acquire)) {
+      lastReading = pinReadFast(pin);
+      lastDebounceTime = now;
+    }
+
+    uint8_t tail = edgeTail.load(std::memory_order_relaxed);
+    while (tail != edgeHead.load(std::memory_order_acquire)) {
+      lastReading = edges[tail].level;
+      lastDebounceTime = edges[tail].time;
+      tail = (tail + 1) % EDGE_QUEUE_SIZE;
+      edgeTail.store(tail, std::memory_order_release);
+    }
+  }
 
   const int pin;             // Digital input pin number
   bool lastReading = false;  // Last raw reading from the pin
@@ -82,6 +157,17 @@ class Button {
       false;  // Set when state changes, cleared by stateJustChanged()
   system_tick_t lastDebounceTime =
       0;  // Time of last state change for debouncing
+
+  // Edge queue filled by the interrupt handler
+  struct Edge {
+    bool level;
+    system_tick_t time;
+  };
+  Edge edges[EDGE_QUEUE_SIZE];
+  std::atomic<uint8_t> edgeHead{0};
+  std::atomic<uint8_t> edgeTail{0};
+  std::atomic<bool> edgeOverflow{false};
+  bool interruptDriven = false;  // Set by begin()
 };
 
 #endif /* __BUTTON_H */
\ No newline at end of file
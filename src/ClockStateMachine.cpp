@@ -10,7 +10,7 @@ ClockStateMachine* ClockStateMachine::instance = nullptr;
  *
  * Sets up:
  * - Button inputs with pulldown resistors
- * - NeoPixel LED strip (176 LEDs on pin D8)
+ * - NeoPixel LED strip (176 LEDs on pin D8, see setup() for split wiring)
  * - Initial time reset
  */
 ClockStateMachine::ClockStateMachine()
@@ -18,7 +18,7 @@ ClockStateMachine::ClockStateMachine()
       manualRainbowSwitch(PIN_MANUAL_RAINBOW),
       manualRedSwitch(PIN_MANUAL_RED),
       countdown50Switch(PIN_COUNTDOWN_50),
-      strip(176, D8, WS2812B),
+      strip(PIN_STRIP),
       display(strip) {
   resetTime();
 }
@@ -40,19 +40,81 @@ static void meshTimeHandler(const char* event, const char* data) {
   }
 }
 
+/**
+ * @brief Mesh network sync event handler callback
+ *
+ * Routes reference time broadcasts from the leading clock to the singleton
+ * instance.
+ *
+ * @param event Event name (unused)
+ * @param data Encoded mode, display options and elapsed time
+ */
+static void meshSyncHandler(const char* event, const char* data) {
+  if (ClockStateMachine::instance) {
+    ClockStateMachine::instance->recvMeshSync(data);
+  }
+}
+
+/**
+ * @brief Mesh network workout program event handler callback
+ *
+ * Routes workout programs broadcast by the leading clock to the singleton
+ * instance.
+ *
+ * @param event Event name (unused)
+ * @param data Workout text
+ */
+static void meshProgramHandler(const char* event, const char* data) {
+  if (ClockStateMachine::instance) {
+    ClockStateMachine::instance->recvMeshProgram(data);
+  }
+}
+
+/**
+ * @brief Mesh network join event handler callback
+ *
+ * Routes announcements from clocks that just joined the mesh to the
+ * singleton instance.
+ *
+ * @param event Event name (unused)
+ * @param data Unused
+ */
+static void meshJoinHandler(const char* event, const char* data) {
+  if (ClockStateMachine::instance) {
+    ClockStateMachine::instance->recvMeshJoin();
+  }
+}
+
 /**
  * @brief Initializes the clock hardware and network connection
  *
  * - Sets up NeoPixel strip
  * - Configures built-in RGB LED
- * - Initializes mesh network
- * - Runs startup animation while waiting for network
+ * - Starts joining the mesh network
+ * - Registers the "latency" cloud variable
+ *
+ * Returns without waiting for the mesh: the clock works on its own right
+ * away and the loop plays the loading animation while the network comes up
+ * (see stateSleep() and updateMeshStatus()).
  */
 void ClockStateMachine::setup() {
   // Set the static instance
   instance = this;
 
+  // Switch inputs to edge interrupts
+  powerSwitch.begin();
+  manualRainbowSwitch.begin();
+  manualRedSwitch.begin();
+  countdown50Switch.begin();
+
   // Initialize NeoPixel strip
+#ifdef PACE_CLOCK_SPLIT_STRIP
+  // The left digits stay on PIN_STRIP while the dots and the right digits
+  // get lines of their own; they clock out together, so a full frame takes
+  // the time of one pair of digits instead of the whole chain
+  strip.addChannel(SegmentDisplay::Layout::separatorFirst(1), PIN_STRIP_DOTS);
+  strip.addChannel(SegmentDisplay::Layout::digitFirst(2), PIN_STRIP_RIGHT);
+#endif
   strip.begin();
   strip.clear();
   strip.show();
@@ -68,59 +130,345 @@ void ClockStateMachine::setup() {
   Mesh.on();
   Mesh.connect();
   Mesh.subscribe("meshTime", meshTimeHandler);
+  Mesh.subscribe("meshSync", meshSyncHandler);
+  Mesh.subscribe("meshProgram", meshProgramHandler);
+  Mesh.subscribe("meshJoin", meshJoinHandler);
 
-  // Run startup animation
-  delay(500);
-  while (!Mesh.ready()) {
-    display.loading();
-  }
+  // Workout programs can be loaded over serial
+  Serial.begin(9600);
+
+  Particle.variable("latency", latencyVariable);
 }
 
 /**
  * @brief Main update loop
  *
- * Updates button states and executes current state handler function
+ * Updates button states, applies received mesh messages, executes current
+ * state handler function and broadcasts the reference time to other clocks
+ * when needed. Each pass is timed into loopLatency.
  */
 void ClockStateMachine::loop() {
+  uint32_t loopStart = LatencyHistogram::now();
+
+  if (!bootLoopTime) {
+    bootLoopTime = millis() + 1;
+  }
+
+  updateMeshStatus();
   updateButtons();
+  updateSerial();
+  processMeshMessages();
+  updateFrameError();
 
   // Execute current state
   if (stateHandler) {
     stateHandler(*this);
   }
+
+  syncMesh();
+  updateLatencyVariable();
+
+  loopLatency.record(loopStart);
+}
+
+/**
+ * @brief Frame scheduler for the active and follower states
+ *
+ * Display transitions (second changes and dot toggles) happen every
+ * refreshInterval milliseconds counted from startTime; animated modes add
+ * frames in between, at an interval that divides refreshInterval so the
+ * transitions still fall on a frame. Rather than polling from whenever the
+ * loop happened to run, the next frame time is computed from startTime and
+ * the frame is rendered frameLeadTime milliseconds early, to cover render
+ * and show() latency. The schedule is realigned whenever the state, start
+ * time or interval changes, or frames were missed.
+ *
+ * @param interval Milliseconds between frames
+ * @return true if the frame for frameTime should be rendered now
+ */
+bool ClockStateMachine::frameDue(system_tick_t interval) {
+  system_tick_t target = millis() + frameLeadTime;
+
+  if (stateHandler != scheduledHandler || startTime != scheduledStartTime ||
+      interval != scheduledInterval ||
+      (int32_t) (target - nextFrameTime) >= (int32_t) interval) {
+    // Render the current frame right away, then follow the timeline
+    scheduledHandler = stateHandler;
+    scheduledStartTime = startTime;
+    scheduledInterval = interval;
+    nextFrameTime = target - ((target - startTime) % interval);
+  }
+
+  if ((int32_t) (target - nextFrameTime) < 0) {
+    return false;
+  }
+
+  frameTime = nextFrameTime;
+  nextFrameTime += interval;
+  return true;
+}
+
+/**
+ * @brief Milliseconds between frames of a mode
+ *
+ * The rainbow and animated display effects change continuously, and the
+ * tenths display every tenth of a second; otherwise the display only
+ * changes on second and dot transitions.
+ */
+system_tick_t ClockStateMachine::frameInterval(uint8_t mode) const {
+  if (mode == MODE_MANUAL_RAINBOW || animating) {
+    return ANIMATION_FRAME_INTERVAL;
+  }
+  if (showTenths && mode == MODE_MANUAL_RED) {
+    return TENTHS_FRAME_INTERVAL;
+  }
+  return refreshInterval;
+}
+
+/**
+ * @brief Records how far a shown frame landed from its transition
+ *
+ * Errors are kept in FRAME_ERROR_BUCKETS buckets of FRAME_ERROR_BUCKET_MS
+ * milliseconds each, starting at FRAME_ERROR_MIN_MS. Errors outside that
+ * range are counted in the first and last buckets.
+ *
+ * @param errorMs Actual minus intended transition time in milliseconds
+ */
+void ClockStateMachine::recordFrameError(int32_t errorMs) {
+  int32_t bucket = (errorMs - FRAME_ERROR_MIN_MS) / FRAME_ERROR_BUCKET_MS;
+  if (errorMs < FRAME_ERROR_MIN_MS) {
+    bucket = 0;
+  } else if (bucket >= FRAME_ERROR_BUCKETS) {
+    bucket = FRAME_ERROR_BUCKETS - 1;
+  }
+  frameErrorHistogram[bucket]++;
+}
+
+/**
+ * @brief Records the transition error of the frame being clocked out once
+ * the strip has finished sending it
+ *
+ * The LEDs take their new colors as the frame finishes, so that moment is
+ * measured against the frame's transition time. Completion is noticed by
+ * polling the strip from the loop, so the error includes up to one loop
+ * pass.
+ */
+void ClockStateMachine::updateFrameError() {
+  if (framePending && !strip.isBusy()) {
+    framePending = false;
+    recordFrameError((int32_t) (millis() - pendingFrameTime));
+  }
+}
+
+/**
+ * @brief Renders the frame for frameTime if one is due
+ *
+ * @param render Member function rendering the active mode
+ * @param mode Mode being rendered, selects the frame interval
+ */
+void ClockStateMachine::renderIfDue(void (ClockStateMachine::*render)(),
+                                    uint8_t mode) {
+  if (frameDue(frameInterval(mode))) {
+    uint32_t framesSent = display.getFramesSent();
+    (this->*render)();
+    if (display.getFramesSent() != framesSent) {
+      // Timed by updateFrameError() once the strip has sent it
+      framePending = true;
+      pendingFrameTime = frameTime;
+    }
+    if (!bootFrameTime) {
+      bootFrameTime = millis() + 1;
+      Log.info("first frame %lu ms after boot", (unsigned long) millis());
+    }
+  }
+}
+
+/**
+ * @brief Formats the transition error histogram
+ *
+ * Format: "LOWER_MS:COUNT,..." for every non-empty bucket
+ * Example: "-2:3,0:7188,2:9"
+ *
+ * @param buffer Output buffer
+ * @param size Size of the output buffer
+ */
+void ClockStateMachine::formatFrameErrors(char* buffer, size_t size) const {
+  size_t len = 0;
+  buffer[0] = '\0';
+  for (int i = 0; i < FRAME_ERROR_BUCKETS && len < size; i++) {
+    if (frameErrorHistogram[i]) {
+      len += snprintf(buffer + len, size - len, "%s%ld:%lu", len ? "," : "",
+                      (long) (FRAME_ERROR_MIN_MS + i * FRAME_ERROR_BUCKET_MS),
+                      (unsigned long) frameErrorHistogram[i]);
+    }
+  }
+}
+
+/**
+ * @brief Formats how long the clock took to become usable after boot
+ *
+ * Format: "loop LOOP_MS,frame FRAME_MS,mesh MESH_MS" in milliseconds since
+ * boot, each "-" until it happened. The frame is the first one rendered in
+ * an operational state, the mesh time when the network first came up.
+ * Example: "loop 0,frame 1000,mesh 30000"
+ *
+ * @param buffer Output buffer
+ * @param size Size of the output buffer
+ */
+void ClockStateMachine::formatBootTimes(char* buffer, size_t size) const {
+  const system_tick_t times[] = {bootLoopTime, bootFrameTime, bootMeshTime};
+  const char* names[] = {"loop", "frame", "mesh"};
+  size_t len = 0;
+  buffer[0] = '\0';
+  for (int i = 0; i < 3 && len < size; i++) {
+    if (times[i]) {
+      len += snprintf(buffer + len, size - len, "%s%s %lu", len ? "," : "",
+                      names[i], (unsigned long) (times[i] - 1));
+    } else {
+      len += snprintf(buffer + len, size - len, "%s%s -", len ? "," : "",
+                      names[i]);
+    }
+  }
+}
+
+/**
+ * @brief Checks that the tenths display moved on by exactly one tenth
+ *
+ * Called with every tenths frame. A jump of more than one tenth means
+ * tenths were skipped; a change that comes more than half a tenth late
+ * means the previous tenth stayed up for two, as if shown twice. Counting
+ * starts over when the state or start time changes.
+ *
+ * @param tenth Tenths since startTime shown by the frame
+ */
+void ClockStateMachine::recordTenth(uint32_t tenth) {
+  system_tick_t now = millis();
+
+  if (stateHandler != tenthsHandler || startTime != tenthsStartTime ||
+      tenth < lastTenth) {
+    tenthsHandler = stateHandler;
+    tenthsStartTime = startTime;
+  } else if (tenth == lastTenth) {
+    return;  // Another frame of the same tenth, e.g. for the rainbow
+  } else {
+    tenthsSkipped += tenth - lastTenth - 1;
+    if (now - lastTenthAt > TENTHS_FRAME_INTERVAL * 3 / 2) {
+      tenthsDoubled++;
+    }
+  }
+
+  tenthsShown++;
+  lastTenth = tenth;
+  lastTenthAt = now;
+}
+
+/**
+ * @brief Formats the tenths display check
+ *
+ * Format: "shown N,skipped N,doubled N"
+ *
+ * @param buffer Output buffer
+ * @param size Size of the output buffer
+ */
+void ClockStateMachine::formatTenthsStats(char* buffer, size_t size) const {
+  snprintf(buffer, size, "shown %lu,skipped %lu,doubled %lu",
+           (unsigned long) tenthsShown, (unsigned long) tenthsSkipped,
+           (unsigned long) tenthsDoubled);
+}
+
+/**
+ * @brief Formats the loop, render and show latency histograms
+ *
+ * Render is SegmentDisplay::setTime() without its show, show is the time
+ * spent in the strip's show calls. Durations are in microseconds (see
+ * LatencyHistogram::format()). The histograms are only recorded on the
+ * application thread, which also formats them, so they are read in place.
+ * Format: "loop STATS;render STATS;show STATS"
+ * Example: "loop n 90000,min 1.2,p50 3.9,p99 15.9,max 40.6;render ..."
+ *
+ * @param buffer Output buffer
+ * @param size Size of the output buffer
+ */
+void ClockStateMachine::formatLatency(char* buffer, size_t size) const {
+  const LatencyHistogram* histograms[] = {&loopLatency,
+                                          &display.getRenderLatency(),
+                                          &display.getShowLatency()};
+  const char* names[] = {"loop", "render", "show"};
+  size_t len = 0;
+  buffer[0] = '\0';
+  for (int i = 0; i < 3 && len < size; i++) {
+    len += snprintf(buffer + len, size - len, "%s%s ", len ? ";" : "",
+                    names[i]);
+    if (len < size) {
+      histograms[i]->format(buffer + len, size - len);
+      len += strlen(buffer + len);
+    }
+  }
 }
 
 /**
- * @brief Helper function for state update timing
+ * @brief Starts the latency histograms over
+ */
+void ClockStateMachine::resetLatency() {
+  loopLatency.reset();
+  display.resetLatency();
+}
+
+/**
+ * @brief Refreshes the "latency" cloud variable
  *
- * @param lastUpdate Last update timestamp
- * @param interval Desired update interval in milliseconds
- * @return true if enough time has elapsed since last update
+ * Formatted every LATENCY_VARIABLE_INTERVAL rather than on every loop, so
+ * reading the variable costs the loop nothing. The cloud reads it from the
+ * system thread, so the new text is formatted aside and copied in with
+ * interrupts off.
  */
-bool shouldUpdate(system_tick_t& lastUpdate, unsigned int interval) {
+void ClockStateMachine::updateLatencyVariable() {
   system_tick_t now = millis();
-  if (now - lastUpdate >= interval) {
-    lastUpdate = now;
-    return true;
+  if (latencyVariable[0] &&
+      now - latencyVariableTime < LATENCY_VARIABLE_INTERVAL) {
+    return;
+  }
+  latencyVariableTime = now;
+  char text[sizeof(latencyVariable)];
+  formatLatency(text, sizeof(text));
+  ATOMIC_BLOCK() {
+    memcpy(latencyVariable, text, sizeof(text));
   }
-  return false;
+}
+
+/**
+ * @brief Sets how early frames are rendered ahead of their transition
+ *
+ * @param leadMs Lead time in milliseconds, less than the shortest frame
+ *        interval
+ * @return true if the lead time was changed, false if out of range
+ */
+bool ClockStateMachine::setFrameLeadTime(system_tick_t leadMs) {
+  if (leadMs >= ANIMATION_FRAME_INTERVAL) {
+    return false;
+  }
+  frameLeadTime = leadMs;
+  return true;
 }
 
 /**
  * @brief Sleep state handler - display off
  *
- * Display is turned off and RGB LED set to dim blue.
- * Transitions to active state when power switch is turned on.
+ * Display is turned off and RGB LED set to dim blue. While the mesh network
+ * is still coming up the loading animation plays instead.
+ * Transitions to active state when power switch is turned on, or to the
+ * follower state when another clock broadcasts an active mode.
  *
  * @param csm Reference to state machine instance
  */
 void ClockStateMachine::stateSleep(ClockStateMachine& csm) {
-  static bool firstEntry = true;
-
-  if (firstEntry) {
-    csm.pushTimeToMesh(-1, -1, -1, -1, 1, 0, 0, 0);
+  if (!csm.meshReady) {
+    csm.display.loading(millis());
+    csm.sleepEntered = false;
+  } else if (!csm.sleepEntered) {
+    csm.showTime(-1, -1, -1, -1, 1, 0, 0, 0);
     RGB.color(0, 0, 10);
-    firstEntry = false;
+    csm.sleepEntered = true;
   }
 
   // Transitions
@@ -136,7 +484,13 @@ void ClockStateMachine::stateSleep(ClockStateMachine& csm) {
     // Set initial state
     RGB.color(0, 10, 0);
     csm.resetTime();
-    firstEntry = true;
+    csm.followMode = MODE_SLEEP;
+    csm.sleepEntered = false;
+  } else if (csm.followMode != MODE_SLEEP) {
+    // Another clock is leading, render its mode locally
+    csm.stateHandler = &stateFollow;
+    RGB.color(0, 10, 0);
+    csm.sleepEntered = false;
   }
 }
 
@@ -144,21 +498,12 @@ void ClockStateMachine::stateSleep(ClockStateMachine& csm) {
  * @brief Rainbow color mode state handler
  *
  * Displays elapsed time with cycling rainbow colors.
- * Updates every refreshInterval milliseconds.
+ * Updates every ANIMATION_FRAME_INTERVAL (see frameDue()).
  *
  * @param csm Reference to state machine instance
  */
 void ClockStateMachine::stateManualRainbow(ClockStateMachine& csm) {
-  static system_tick_t lastUpdate = 0;
-
-  if (shouldUpdate(lastUpdate, csm.refreshInterval)) {
-    uint32_t elapsedSec = millis() / 1000;
-    uint8_t wheelPos = (elapsedSec % 240) * 1.0625;  // 255/240 ≈ 1.0625
-
-    int r, g, b;
-    csm.calculateRainbowColor(wheelPos, r, g, b);
-    csm.updateTimeFromMillis(r, g, b);
-  }
+  csm.renderIfDue(&ClockStateMachine::renderManualRainbow, MODE_MANUAL_RAINBOW);
 
   // Transitions
   if (!csm.powerSwitch.isOn()) {
@@ -177,16 +522,12 @@ void ClockStateMachine::stateManualRainbow(ClockStateMachine& csm) {
  * @brief Red color mode state handler
  *
  * Displays elapsed time in solid red color.
- * Updates every refreshInterval milliseconds.
+ * Updates on every refreshInterval transition (see frameDue()).
  *
  * @param csm Reference to state machine instance
  */
 void ClockStateMachine::stateManualRed(ClockStateMachine& csm) {
-  static system_tick_t lastUpdate = 0;
-
-  if (shouldUpdate(lastUpdate, csm.refreshInterval)) {
-    csm.updateTimeFromMillis(255, 0, 0);
-  }
+  csm.renderIfDue(&ClockStateMachine::renderManualRed, MODE_MANUAL_RED);
 
   // Transitions
   if (!csm.powerSwitch.isOn()) {
@@ -204,90 +545,302 @@ void ClockStateMachine::stateManualRed(ClockStateMachine& csm) {
 /**
  * @brief 50-minute countdown state handler
  *
+ * Renders the countdown timeline (see renderCountdown50()) on every
+ * refreshInterval transition (see frameDue()).
+ *
+ * @param csm Reference to state machine instance
+ */
+void ClockStateMachine::stateCountdown50(ClockStateMachine& csm) {
+  csm.renderIfDue(&ClockStateMachine::renderCountdown50, MODE_COUNTDOWN_50);
+
+  // Transitions
+  if (!csm.powerSwitch.isOn()) {
+    csm.stateHandler = &stateSleep;
+    return;
+  }
+  if (csm.manualRainbowSwitch.isOn()) {
+    csm.resetTime();
+    csm.stateHandler = &stateManualRainbow;
+  } else if (csm.manualRedSwitch.isOn()) {
+    csm.resetTime();
+    csm.stateHandler = &stateManualRed;
+  }
+}
+
+/**
+ * @brief Workout program state handler
+ *
+ * Runs the loaded workout program (see renderProgram()). Entered when a
+ * program is loaded while the clock is active. Turning a mode switch
+ * returns to that mode.
+ *
+ * @param csm Reference to state machine instance
+ */
+void ClockStateMachine::stateProgram(ClockStateMachine& csm) {
+  if (!csm.programEntered) {
+    // Only switch changes from here on leave the program
+    csm.manualRainbowSwitch.stateJustChanged();
+    csm.manualRedSwitch.stateJustChanged();
+    csm.countdown50Switch.stateJustChanged();
+    csm.programEntered = true;
+  }
+
+  csm.renderIfDue(&ClockStateMachine::renderProgram, MODE_PROGRAM);
+
+  // Transitions
+  if (!csm.powerSwitch.isOn()) {
+    csm.stateHandler = &stateSleep;
+    csm.programEntered = false;
+    return;
+  }
+  bool rainbowChanged = csm.manualRainbowSwitch.stateJustChanged();
+  bool redChanged = csm.manualRedSwitch.stateJustChanged();
+  bool countdownChanged = csm.countdown50Switch.stateJustChanged();
+  if (rainbowChanged || redChanged || countdownChanged) {
+    if (csm.manualRedSwitch.isOn()) {
+      csm.stateHandler = &stateManualRed;
+    } else if (csm.countdown50Switch.isOn()) {
+      csm.resetTime();
+      csm.stateHandler = &stateCountdown50;
+    } else {
+      csm.resetTime();
+      csm.stateHandler = &stateManualRainbow;
+    }
+    csm.programEntered = false;
+  }
+}
+
+/**
+ * @brief Follower state handler - mirrors the leading clock
+ *
+ * Renders the mode last broadcast by the leading clock from the local copy
+ * of its start time, so the display keeps ticking if a sync message is lost,
+ * with the leader's effect and tenths display.
+ * Goes back to sleep if the leader goes to sleep or stops sending
+ * heartbeats, and takes over as soon as the local power switch is turned on.
+ *
+ * @param csm Reference to state machine instance
+ */
+void ClockStateMachine::stateFollow(ClockStateMachine& csm) {
+  csm.setCountUpEffect(csm.followOptions & SYNC_OPTION_EFFECT);
+  csm.showTenths = csm.followOptions & SYNC_OPTION_TENTHS;
+  csm.renderIfDue(&ClockStateMachine::renderFollowMode, csm.followMode);
+
+  // Transitions
+  if (csm.powerSwitch.isOn() || csm.followMode == MODE_SLEEP ||
+      millis() - csm.lastSyncReceived >= SYNC_TIMEOUT) {
+    csm.followMode = MODE_SLEEP;
+    csm.stateHandler = &stateSleep;
+  }
+}
+
+/**
+ * @brief Renders one frame of the given mode
+ *
+ * @param mode Mode to render, as broadcast by the leading clock
+ */
+void ClockStateMachine::renderMode(uint8_t mode) {
+  switch (mode) {
+    case MODE_MANUAL_RAINBOW:
+      renderManualRainbow();
+      break;
+    case MODE_MANUAL_RED:
+      renderManualRed();
+      break;
+    case MODE_COUNTDOWN_50:
+      renderCountdown50();
+      break;
+    case MODE_PROGRAM:
+      renderProgram();
+      break;
+    default:
+      showTime(-1, -1, -1, -1, 1, 0, 0, 0);
+      break;
+  }
+}
+
+/**
+ * @brief Renders the mode broadcast by the leading clock
+ */
+void ClockStateMachine::renderFollowMode() {
+  renderMode(followMode);
+}
+
+/**
+ * @brief Renders elapsed time with a rainbow color
+ *
+ * The color turns smoothly through the wheel once every RAINBOW_PERIOD_MS
+ * of elapsed time.
+ */
+void ClockStateMachine::renderManualRainbow() {
+  uint16_t hue = HueWheel::fromTime(frameTime - startTime, RAINBOW_PERIOD_MS);
+
+  int r, g, b;
+  HueWheel::toRgb(hue, r, g, b);
+  updateTimeFromMillis(r, g, b);
+}
+
+/**
+ * @brief Renders elapsed time in solid red
+ */
+void ClockStateMachine::renderManualRed() {
+  updateTimeFromMillis(255, 0, 0);
+}
+
+/**
+ * @brief Countdown 50 timeline: round k lasts COUNTDOWN_FIRST_ROUND - k
+ * seconds, and the session ends after the COUNTDOWN_LAST_ROUND second round
+ */
+static const int32_t COUNTDOWN_FIRST_ROUND = 60;
+static const int32_t COUNTDOWN_LAST_ROUND = 21;
+
+/**
+ * @brief Start offset of a Countdown 50 round
+ *
+ * Closed form of the arithmetic series 60 + 59 + ... over the k rounds
+ * before it.
+ *
+ * @param k Round index, 0 for the 60 second round
+ * @return Seconds from the first round's start to round k's start
+ */
+static inline int32_t countdownRoundStart(int32_t k) {
+  return COUNTDOWN_FIRST_ROUND * k - k * (k - 1) / 2;
+}
+
+/**
+ * @brief Countdown 50 display for a point in the session
+ *
  * Implements a specialized countdown timer for swim training:
  * - Initial 22 second preparation period with two 10-second countdowns
  * - Main countdown starting at 60 seconds, decreasing by 1 second each round
  * - Color changes indicate time remaining in each countdown
  * - Group number shows current phase
  *
- * @param csm Reference to state machine instance
+ * @param elapsedMs Milliseconds since the session started
+ * @return Digits and color to show, or done once the session is over
  */
-void ClockStateMachine::stateCountdown50(ClockStateMachine& csm) {
-  static system_tick_t lastUpdate = 0;
+ClockStateMachine::CountdownFrame ClockStateMachine::countdownFrame(
+    uint32_t elapsedMs) {
+  CountdownFrame frame;
+  int32_t elapsedSec = (elapsedMs / 1000) - 30;
 
-  if (shouldUpdate(lastUpdate, csm.refreshInterval)) {
-    uint32_t now = millis();
+  // Calculate current round: the last one starting at or before elapsedSec
+  int32_t round = 0;
+  int32_t lastRound = COUNTDOWN_FIRST_ROUND - COUNTDOWN_LAST_ROUND + 1;
+  while (round < lastRound) {
+    int32_t mid = (round + lastRound + 1) / 2;
+    if (countdownRoundStart(mid) <= elapsedSec) {
+      round = mid;
+    } else {
+      lastRound = mid - 1;
+    }
+  }
+  int8_t initialTime = COUNTDOWN_FIRST_ROUND - round;
+  int32_t totalSec = countdownRoundStart(round);
 
-    int8_t initialTime = 60;
-    int32_t elapsedSec = ((now - csm.startTime) / 1000) - 30;
-    int32_t totalSec = 0;
+  // Check if we're done
+  frame.done = initialTime < COUNTDOWN_LAST_ROUND;
+  if (frame.done) {
+    return frame;
+  }
 
-    // Calculate current round
-    while (elapsedSec >= totalSec + initialTime) {
-      totalSec += initialTime;
-      initialTime--;
-    }
+  uint32_t roundElapsedSec =
+      elapsedSec < 0 ? initialTime + elapsedSec : elapsedSec - totalSec;
 
-    // Check if we're done
-    if (initialTime <= 20) {
-      csm.pushTimeToMesh(-1, -1, -1, -1, 1, 0, 0, 0);
-      return;
-    }
+  // First 22 seconds: two 10-second countdowns
+  if (roundElapsedSec < (initialTime < 30 ? 12 : 22)) {
+    frame.remainingSec = 10 - (roundElapsedSec % 10);
 
-    uint32_t roundElapsedSec =
-        elapsedSec < 0 ? initialTime + elapsedSec : elapsedSec - totalSec;
-    uint8_t remainingSec;
-    int r, g, b;
-    int group = 0;
-
-    // First 22 seconds: two 10-second countdowns
-    if (roundElapsedSec < (initialTime < 30 ? 12 : 22)) {
-      remainingSec = 10 - (roundElapsedSec % 10);
-
-      // Set group based on phase
-      group = (roundElapsedSec < 2) ? 1 : (roundElapsedSec < 12) ? 2 : 3;
-
-      // Color selection
-      if (remainingSec > 8) {
-        r = 255;
-        g = 0;
-        b = 0;
-        remainingSec = initialTime == 60 ? 0 : initialTime + 1;
-      } else {
-        r = (remainingSec > 6) ? 100 : (remainingSec > 3) ? 255 : 255;
-        g = (remainingSec > 6) ? 255 : (remainingSec > 3) ? 255 : 100;
-        b = 0;
-      }
-    }
-    // Normal round timing
-    else {
-      remainingSec = initialTime - (roundElapsedSec % initialTime);
-      group = (remainingSec <= 10) ? 1 : 0;
-
-      // Color selection
-      r = (remainingSec > 6) ? 100 : (remainingSec > 3) ? 255 : 255;
-      g = (remainingSec > 6) ? 255 : (remainingSec > 3) ? 255 : 100;
-      b = 0;
+    // Set group based on phase
+    frame.group = (roundElapsedSec < 2) ? 1 : (roundElapsedSec < 12) ? 2 : 3;
+
+    // Color selection
+    if (frame.remainingSec > 8) {
+      frame.r = 255;
+      frame.g = 0;
+      frame.b = 0;
+      frame.remainingSec = initialTime == 60 ? 0 : initialTime + 1;
+      return frame;
     }
+  }
+  // Normal round timing
+  else {
+    frame.remainingSec = initialTime - (roundElapsedSec % initialTime);
+    frame.finalSeconds = frame.remainingSec <= FINAL_SECONDS;
+    frame.group = frame.finalSeconds ? 1 : 0;
+  }
 
-    // Update display
-    csm.pushTimeToMesh(group == 0 ? -1 : group, -1, remainingSec / 10,
-                       remainingSec % 10, ((now % 1000) < 500) ? 3 : 4, r, g,
-                       b);
+  // Color selection
+  frame.r = (frame.remainingSec > 6) ? 100 : 255;
+  frame.g = (frame.remainingSec > 3) ? 255 : 100;
+  frame.b = 0;
+  return frame;
+}
+
+/**
+ * @brief Renders the 50-minute countdown timeline (see countdownFrame())
+ */
+void ClockStateMachine::renderCountdown50() {
+  uint32_t elapsedMs = frameTime - startTime;
+  CountdownFrame frame = countdownFrame(elapsedMs);
+
+  if (frame.done) {
+    showTime(-1, -1, -1, -1, 1, 0, 0, 0);
+    return;
   }
 
-  // Transitions
-  if (!csm.powerSwitch.isOn()) {
-    csm.stateHandler = &stateSleep;
+  // Update display, pulsing through the last seconds of a round
+  SegmentDisplay::Effect effect;
+  if (frame.finalSeconds) {
+    effect = finalSecondsEffect(elapsedMs);
+  }
+  showTime(frame.group == 0 ? -1 : frame.group, -1, frame.remainingSec / 10,
+           frame.remainingSec % 10, ((elapsedMs % 1000) < 500) ? 3 : 4,
+           frame.r, frame.g, frame.b, effect);
+}
+
+/**
+ * @brief Renders the loaded workout program
+ *
+ * Shows the set label on the leftmost digit and the time left in the
+ * current repeat as M:SS in the set's color. The display turns off once
+ * the program has finished.
+ */
+void ClockStateMachine::renderProgram() {
+  uint32_t elapsedMs = frameTime - startTime;
+  WorkoutProgram::Position position;
+
+  if (!program.lookup(elapsedMs / 1000, position)) {
+    showTime(-1, -1, -1, -1, 1, 0, 0, 0);
     return;
   }
-  if (csm.manualRainbowSwitch.isOn()) {
-    csm.resetTime();
-    csm.stateHandler = &stateManualRainbow;
-  } else if (csm.manualRedSwitch.isOn()) {
-    csm.resetTime();
-    csm.stateHandler = &stateManualRed;
+
+  const WorkoutProgram::Set& set = *position.set;
+  uint16_t minutes = position.remainingSec / 60;
+  uint16_t seconds = position.remainingSec % 60;
+  int dotStatus = ((elapsedMs % 1000) < 500) ? 3 : 4;
+
+  SegmentDisplay::Effect effect;
+  if (position.remainingSec <= FINAL_SECONDS) {
+    effect = finalSecondsEffect(elapsedMs);
   }
+
+  showTime(set.label, minutes == 0 ? -1 : minutes, seconds / 10, seconds % 10,
+           dotStatus, set.r, set.g, set.b, effect);
+}
+
+/**
+ * @brief Effect for the last seconds of an interval: a pulse every second
+ *
+ * @param elapsedMs Time since startTime, the pulses follow its seconds
+ */
+SegmentDisplay::Effect ClockStateMachine::finalSecondsEffect(
+    uint32_t elapsedMs) const {
+  SegmentDisplay::Effect effect;
+  effect.type = SegmentDisplay::Effect::PULSE;
+  effect.depth = PULSE_DEPTH;
+  effect.phase = HueWheel::fromTime(elapsedMs, PULSE_PERIOD_MS);
+  return effect;
 }
 
 /**
@@ -302,18 +855,20 @@ void ClockStateMachine::resetTime() {
 /**
  * @brief Updates display with elapsed time in specified color
  *
- * Converts milliseconds since start into minutes:seconds format.
+ * Converts milliseconds from start to frameTime into minutes:seconds format,
+ * or with showTenths into seconds and tenths, SS.t, on the first three
+ * digits with the bottom dot as the decimal point.
  * Handles special cases:
  * - Over 4 hours: display turns off
- * - Over 60 minutes: wraps around
- * - Leading zero suppression for minutes
+ * - Over 60 minutes: wraps around (SS.t wraps at 100 seconds)
+ * - Leading zero suppression for minutes (and tens of seconds)
  *
  * @param r Red component (0-255)
  * @param g Green component (0-255)
  * @param b Blue component (0-255)
  */
 void ClockStateMachine::updateTimeFromMillis(int r, int g, int b) {
-  uint32_t now = millis();
+  uint32_t now = frameTime;
 
   // Normal time display
   uint32_t elapsedMs = now - startTime;
@@ -324,6 +879,21 @@ void ClockStateMachine::updateTimeFromMillis(int r, int g, int b) {
     r = g = b = 0;  // Turn off display
   }
 
+  // Animate the chosen effect, if any
+  SegmentDisplay::Effect effect = countUpEffect;
+  if (effect.type == SegmentDisplay::Effect::CHASE) {
+    effect.phase = HueWheel::fromTime(elapsedMs, CHASE_PERIOD_MS);
+  }
+
+  if (showTenths) {
+    uint32_t tenths = elapsedMs / 100;
+    uint8_t seconds = (tenths / 10) % 100;
+    showTime(seconds / 10 == 0 ? -1 : seconds / 10, seconds % 10, tenths % 10,
+             -1, 1, r, g, b, effect);
+    recordTenth(tenths);
+    return;
+  }
+
   // Wrap around at 60 minutes (3600 seconds)
   elapsedSec = elapsedSec % 3600;
   uint8_t minutes = (elapsedSec / 60);
@@ -332,48 +902,37 @@ void ClockStateMachine::updateTimeFromMillis(int r, int g, int b) {
   // Alternate dot status every 500ms
   int dotStatus = ((elapsedMs % 1000) < 500) ? 3 : 4;
 
-  pushTimeToMesh(minutes / 10 == 0 ? -1 : minutes / 10, minutes % 10,
-                 seconds / 10, seconds % 10, dotStatus, r, g, b);
+  showTime(minutes / 10 == 0 ? -1 : minutes / 10, minutes % 10, seconds / 10,
+           seconds % 10, dotStatus, r, g, b, effect);
 }
 
 /**
- * @brief Calculates RGB values for rainbow effect
+ * @brief Sets the effect of the count-up modes
  *
- * Converts position (0-255) into smooth RGB transitions:
- * 0-84: Red to Green
- * 85-169: Green to Blue
- * 170-255: Blue to Red
+ * Only the type is chosen over serial and shared with other clocks; the
+ * gradient always fades to blue. A change is drawn on the next loop rather
+ * than at the next frame of the old effect, so a leader and its followers
+ * switch together.
  *
- * @param pos Position in color wheel (0-255)
- * @param r Output red component
- * @param g Output green component
- * @param b Output blue component
+ * @param type SegmentDisplay::Effect::SOLID, GRADIENT or CHASE
  */
-void ClockStateMachine::calculateRainbowColor(uint8_t pos,
-                                              int& r,
-                                              int& g,
-                                              int& b) {
-  if (pos < 85) {
-    r = pos * 3;
-    g = 255 - pos * 3;
-    b = 0;
-  } else if (pos < 170) {
-    pos -= 85;
-    r = 255 - pos * 3;
-    g = 0;
-    b = pos * 3;
-  } else {
-    pos -= 170;
-    r = 0;
-    g = pos * 3;
-    b = 255 - pos * 3;
+void ClockStateMachine::setCountUpEffect(uint8_t type) {
+  if (type == countUpEffect.type) {
+    return;
+  }
+  countUpEffect = SegmentDisplay::Effect();
+  countUpEffect.type = (SegmentDisplay::Effect::Type) type;
+  if (type == SegmentDisplay::Effect::GRADIENT) {
+    countUpEffect.b2 = 255;
   }
+  scheduledHandler = nullptr;  // Realign the frame schedule
 }
 
 /**
  * @brief Updates all button states
  *
- * Calls update() on all button inputs with current time
+ * Calls update() on all button inputs with current time. Buttons only
+ * process queued edges, so this is cheap while the switches are idle.
  */
 void ClockStateMachine::updateButtons() {
   system_tick_t now = millis();
@@ -384,51 +943,447 @@ void ClockStateMachine::updateButtons() {
 }
 
 /**
- * @brief Encodes display state into network message
+ * @brief Handles commands typed over serial
  *
- * Format: "D1,D2,D3,D4,DOT,R,G,B"
- * Example: "-1,5,4,2,3,255,128,0"
+ * Commands are one per line:
+ * - "program SETS": loads a workout, sets separated by ';'
+ *   Example: "program 10 x 50 free @ 1:00; 4 x 75 IM @ 1:30"
+ * - "effect NAME": display effect for the count-up modes, one of "solid",
+ *   "gradient" (fading to blue on the right) or "chase" (running rainbow)
+ * - "tenths on|off": shows seconds and tenths, SS.t, in the count-up modes
+ * - "tenths": prints the tenths display check (see recordTenth())
+ * - "boot": prints how long the clock took to become usable after boot
+ * - "latency": prints the loop, render and show latencies (see
+ *   formatLatency())
+ * - "latency reset": starts the latency histograms over
+ */
+void ClockStateMachine::updateSerial() {
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c != '\n' && c != '\r') {
+      if (serialLength < sizeof(serialLine) - 1) {
+        serialLine[serialLength++] = c;
+      }
+      continue;
+    }
+    if (serialLength == 0) {
+      continue;
+    }
+
+    serialLine[serialLength] = '\0';
+    serialLength = 0;
+
+    if (strncmp(serialLine, "program ", 8) == 0) {
+      if (loadProgram(serialLine + 8)) {
+        Serial.printlnf("program loaded, %lu s",
+                        (unsigned long) program.getTotalSec());
+      } else {
+        Serial.println("program invalid");
+      }
+    } else if (strncmp(serialLine, "effect ", 7) == 0) {
+      const char* name = serialLine + 7;
+      uint8_t type = SegmentDisplay::Effect::SOLID;
+      if (strcmp(name, "gradient") == 0) {
+        type = SegmentDisplay::Effect::GRADIENT;
+      } else if (strcmp(name, "chase") == 0) {
+        type = SegmentDisplay::Effect::CHASE;
+      } else if (strcmp(name, "solid") != 0) {
+        Serial.println("unknown effect");
+        continue;
+      }
+      setCountUpEffect(type);
+      Serial.printlnf("effect %s", name);
+    } else if (strcmp(serialLine, "tenths on") == 0 ||
+               strcmp(serialLine, "tenths off") == 0) {
+      showTenths = serialLine[8] == 'n';
+      Serial.println(serialLine);
+    } else if (strcmp(serialLine, "tenths") == 0) {
+      char stats[64];
+      formatTenthsStats(stats, sizeof(stats));
+      Serial.printlnf("tenths %s", stats);
+    } else if (strcmp(serialLine, "boot") == 0) {
+      char bootTimes[48];
+      formatBootTimes(bootTimes, sizeof(bootTimes));
+      Serial.printlnf("boot %s", bootTimes);
+    } else if (strcmp(serialLine, "latency") == 0) {
+      char latency[256];
+      formatLatency(latency, sizeof(latency));
+      Serial.printlnf("latency %s", latency);
+    } else if (strcmp(serialLine, "latency reset") == 0) {
+      resetLatency();
+      Serial.println(serialLine);
+    } else if (strcmp(serialLine, "lead") == 0) {
+      char frameErrors[256];
+      formatFrameErrors(frameErrors, sizeof(frameErrors));
+      Serial.printlnf("lead %lu ms,errors %s", (unsigned long) frameLeadTime,
+                      frameErrors);
+    } else if (strncmp(serialLine, "lead ", 5) == 0) {
+      char* end;
+      unsigned long leadMs = strtoul(serialLine + 5, &end, 10);
+      if (end == serialLine + 5 || *end || !setFrameLeadTime(leadMs)) {
+        Serial.println("lead invalid");
+        continue;
+      }
+      Serial.printlnf("lead %lu ms", leadMs);
+    } else {
+      Serial.println("unknown command");
+    }
+  }
+}
+
+/**
+ * @brief Compiles and starts a workout program
  *
- * @param buffer Output buffer (min 32 bytes)
- * @param d1-d4 Digits to display (-1 for blank)
- * @param dot Dot display mode
- * @param r,g,b Color components
+ * If the clock is active, the program starts right away and syncMesh()
+ * broadcasts it to the other clocks once the mesh is up. Otherwise it is
+ * kept until loaded again while the clock is on.
+ *
+ * @param text Workout text (see WorkoutProgram::compile())
+ * @return true if the program compiled, false otherwise
+ */
+bool ClockStateMachine::loadProgram(const char* text) {
+  if (!program.compile(text)) {
+    return false;
+  }
+
+  if (currentMode() != MODE_SLEEP) {
+    resetTime();
+    stateHandler = &stateProgram;
+    programUnsent = true;
+  }
+  return true;
+}
+
+/**
+ * @brief Handles a workout program broadcast from the leading clock
+ *
+ * @param data Workout text
+ *
+ * Runs on the system thread: the text is only handed to the loop, see
+ * processMeshMessages().
  */
-void ClockStateMachine::encodeDisplayData(char* buffer,
-                                          int d1,
-                                          int d2,
-                                          int d3,
-                                          int d4,
-                                          int dot,
-                                          int r,
-                                          int g,
-                                          int b) {
-  // Format: D1,D2,D3,D4,DOT,R,G,B
-  // Example: "-1,5,4,2,3,255,128,0"
-  snprintf(buffer, 32, "%d,%d,%d,%d,%d,%d,%d,%d", d1, d2, d3, d4, dot, r, g, b);
+void ClockStateMachine::recvMeshProgram(const char* data) {
+  if (strlen(data) > WorkoutProgram::MAX_SOURCE) {
+    return;
+  }
+  ProgramMessage message;
+  strcpy(message.text, data);
+  programMailbox.post(message);
 }
 
 /**
- * @brief Sends current display state to other clocks via mesh network
+ * @brief Shows a frame on the local display
  *
  * @param d1-d4 The four digits to display
  * @param dot Dot display mode
  * @param r,g,b Color components
+ * @param effect Display effect, frames come faster while it animates
+ */
+void ClockStateMachine::showTime(int d1,
+                                 int d2,
+                                 int d3,
+                                 int d4,
+                                 int dot,
+                                 int r,
+                                 int g,
+                                 int b,
+                                 const SegmentDisplay::Effect& effect) {
+  animating = effect.type == SegmentDisplay::Effect::CHASE ||
+              effect.type == SegmentDisplay::Effect::PULSE;
+  display.setEffect(effect);
+  display.setTime(d1, d2, d3, d4, dot, r, g, b);
+}
+
+/**
+ * @brief Maps the current state handler to its shared mode
  *
- * Encodes the display state into a string and broadcasts it to all
- * connected clocks in the mesh network.
+ * @return Mode of the active state, MODE_SLEEP when sleeping or following
  */
-void ClockStateMachine::pushTimeToMesh(
-    int d1, int d2, int d3, int d4, int dot, int r, int g, int b) {
-  char encodedData[32];
-  encodeDisplayData(encodedData, d1, d2, d3, d4, dot, r, g, b);
-  recvMeshTime(encodedData);              // Update local display
-  Mesh.publish("meshTime", encodedData);  // Broadcast to network
+uint8_t ClockStateMachine::currentMode() const {
+  if (stateHandler == &stateManualRainbow) {
+    return MODE_MANUAL_RAINBOW;
+  } else if (stateHandler == &stateManualRed) {
+    return MODE_MANUAL_RED;
+  } else if (stateHandler == &stateCountdown50) {
+    return MODE_COUNTDOWN_50;
+  } else if (stateHandler == &stateProgram) {
+    return MODE_PROGRAM;
+  }
+  return MODE_SLEEP;
+}
+
+/**
+ * @brief Display options followers render the shared mode with
+ *
+ * @return SYNC_OPTION_ bits: the effect type of the count-up modes, and
+ *         whether they show tenths
+ */
+uint8_t ClockStateMachine::currentOptions() const {
+  return (countUpEffect.type & SYNC_OPTION_EFFECT) |
+         (showTenths ? SYNC_OPTION_TENTHS : 0);
+}
+
+/**
+ * @brief Broadcasts the reference time when it changes
+ *
+ * Only the leading clock (one in an active state) broadcasts. A sync is sent
+ * when the mode, start time or display options change, including once when
+ * the leader goes back to sleep, and otherwise every SYNC_HEARTBEAT_INTERVAL
+ * milliseconds. Followers render every frame themselves from the synced
+ * start time, with the synced options.
+ *
+ * Nothing is sent while the mesh is down; changes made meanwhile go out as
+ * soon as it comes up. A clock that joins late announces itself (see
+ * updateMeshStatus()) and the leader answers right away rather than at the
+ * next heartbeat.
+ */
+void ClockStateMachine::syncMesh() {
+  bool joinRequested = joinReceived.exchange(false, std::memory_order_relaxed);
+
+  if (stateHandler == &stateFollow) {
+    syncedMode = MODE_SLEEP;
+    return;
+  }
+  if (!meshReady) {
+    return;
+  }
+
+  uint8_t mode = currentMode();
+  bool changed = mode != syncedMode ||
+                 (mode != MODE_SLEEP && startTime != syncedStartTime) ||
+                 (mode != MODE_SLEEP && currentOptions() != syncedOptions) ||
+                 (mode == MODE_PROGRAM && programUnsent);
+  bool heartbeat = mode != MODE_SLEEP &&
+                   (joinRequested ||
+                    millis() - lastSyncSent >= SYNC_HEARTBEAT_INTERVAL);
+
+  if (changed || heartbeat) {
+    publishSync(mode);
+  }
+}
+
+/**
+ * @brief Tracks the mesh network connection
+ *
+ * The clock runs on its own from boot; the mesh joins in the background.
+ * When it comes up, a clock that is not leading announces itself on
+ * "meshJoin" so a leader already running answers with its reference time.
+ * A leader needs nothing extra: syncMesh() sends whatever changed while the
+ * mesh was down.
+ */
+void ClockStateMachine::updateMeshStatus() {
+  bool ready = Mesh.ready();
+  if (ready && !meshReady) {
+    if (!bootMeshTime) {
+      bootMeshTime = millis() + 1;
+      Log.info("mesh ready %lu ms after boot", (unsigned long) millis());
+    }
+    if (currentMode() == MODE_SLEEP) {
+      Mesh.publish("meshJoin", "");
+    }
+  }
+  meshReady = ready;
+}
+
+/**
+ * @brief Handles the announcement of a clock that just joined the mesh
+ *
+ * Runs on the system thread: only flags the request for syncMesh().
+ */
+void ClockStateMachine::recvMeshJoin() {
+  joinReceived.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Sends the current mode, display options and elapsed time to other
+ * clocks
+ *
+ * The elapsed time rather than the start time is sent, since each clock
+ * keeps its own millis() counter. Nothing is marked as sent unless every
+ * publish succeeded, so syncMesh() tries again on the next loop.
+ *
+ * @param mode Mode to broadcast
+ */
+void ClockStateMachine::publishSync(uint8_t mode) {
+  system_tick_t now = millis();
+  uint8_t options = currentOptions();
+  char encodedData[SYNC_ENCODED_SIZE];
+  encodeSyncData(encodedData, mode, options, now - startTime);
+  if (mode == MODE_PROGRAM) {
+    // Followers may have joined since the program was loaded
+    if (Mesh.publish("meshProgram", program.getSource()) != 0) {
+      return;
+    }
+    programUnsent = false;
+  }
+  if (Mesh.publish("meshSync", encodedData) != 0) {
+    return;
+  }
+
+  syncedMode = mode;
+  syncedOptions = options;
+  syncedStartTime = startTime;
+  lastSyncSent = now;
+}
+
+/**
+ * @brief Handles a reference time broadcast from the leading clock
+ *
+ * @param data Encoded mode, display options and elapsed time
+ *
+ * Runs on the system thread: the decoded message is only handed to the
+ * loop, see processMeshMessages().
+ */
+void ClockStateMachine::recvMeshSync(const char* data) {
+  SyncMessage message;
+  if (decodeSyncData(data, message.mode, message.options,
+                     message.elapsedMs)) {
+    message.receivedAt = millis();
+    syncMailbox.post(message);
+  }
+}
+
+/**
+ * @brief Base64 alphabet used to carry binary messages as event data
+ */
+static const char BASE64_CHARS[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+ * @brief Maps a base64 character back to its 6-bit value
+ *
+ * @return Value 0-63, or -1 if the character is not in the alphabet
+ */
+static int base64Value(char c) {
+  if (c >= 'A' && c <= 'Z')
+    return c - 'A';
+  if (c >= 'a' && c <= 'z')
+    return c - 'a' + 26;
+  if (c >= '0' && c <= '9')
+    return c - '0' + 52;
+  if (c == '+')
+    return 62;
+  if (c == '/')
+    return 63;
+  return -1;
+}
+
+/**
+ * @brief CRC-8 (polynomial 0x07) over a byte buffer
+ */
+static uint8_t crc8(const uint8_t* data, size_t len) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+/**
+ * @brief Encodes a sync message for the mesh network
+ *
+ * Binary layout (SYNC_MESSAGE_SIZE bytes), sent as unpadded base64:
+ * - [0]    SYNC_VERSION
+ * - [1]    Mode
+ * - [2]    Display options, SYNC_OPTION_ bits
+ * - [3..6] Elapsed milliseconds, little endian
+ * - [7]    CRC-8 of bytes 0-6
+ *
+ * @param buffer Output buffer (min SYNC_ENCODED_SIZE bytes)
+ * @param mode Mode to broadcast
+ * @param options Display options to broadcast
+ * @param elapsedMs Milliseconds since the leader's start time
+ */
+void ClockStateMachine::encodeSyncData(char* buffer,
+                                       uint8_t mode,
+                                       uint8_t options,
+                                       uint32_t elapsedMs) {
+  uint8_t msg[SYNC_MESSAGE_SIZE];
+  msg[0] = SYNC_VERSION;
+  msg[1] = mode;
+  msg[2] = options;
+  for (uint8_t i = 0; i < 4; i++) {
+    msg[3 + i] = elapsedMs >> (8 * i);
+  }
+  msg[7] = crc8(msg, 7);
+
+  // Every 6 bits become one character, the last group is zero padded
+  size_t out = 0;
+  uint32_t bits = 0;
+  uint8_t bitCount = 0;
+  for (size_t i = 0; i < SYNC_MESSAGE_SIZE; i++) {
+    bits = (bits << 8) | msg[i];
+    bitCount += 8;
+    while (bitCount >= 6) {
+      bitCount -= 6;
+      buffer[out++] = BASE64_CHARS[(bits >> bitCount) & 0x3F];
+    }
+  }
+  if (bitCount > 0) {
+    buffer[out++] = BASE64_CHARS[(bits << (6 - bitCount)) & 0x3F];
+  }
+  buffer[out] = '\0';
+}
+
+/**
+ * @brief Decodes a sync message received from the mesh network
+ *
+ * @param data Base64 message produced by encodeSyncData()
+ * @param mode Output parameter for the mode
+ * @param options Output parameter for the display options
+ * @param elapsedMs Output parameter for the elapsed milliseconds
+ * @return true if the message is well formed, of this version and passes
+ *         its checksum, false otherwise
+ */
+bool ClockStateMachine::decodeSyncData(const char* data,
+                                       uint8_t& mode,
+                                       uint8_t& options,
+                                       uint32_t& elapsedMs) {
+  if (strlen(data) != SYNC_ENCODED_SIZE - 1) {
+    return false;
+  }
+
+  uint8_t msg[SYNC_MESSAGE_SIZE];
+  size_t out = 0;
+  uint32_t bits = 0;
+  uint8_t bitCount = 0;
+  for (const char* p = data; *p; p++) {
+    int value = base64Value(*p);
+    if (value < 0) {
+      return false;
+    }
+    bits = (bits << 6) | value;
+    bitCount += 6;
+    if (bitCount >= 8 && out < SYNC_MESSAGE_SIZE) {
+      bitCount -= 8;
+      msg[out++] = bits >> bitCount;
+    }
+  }
+
+  if (msg[0] != SYNC_VERSION || msg[7] != crc8(msg, 7) ||
+      msg[1] > MODE_PROGRAM || (msg[2] & ~SYNC_OPTIONS) ||
+      (msg[2] & SYNC_OPTION_EFFECT) > SegmentDisplay::Effect::CHASE) {
+    return false;
+  }
+
+  mode = msg[1];
+  options = msg[2];
+  elapsedMs = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    elapsedMs |= (uint32_t) msg[3 + i] << (8 * i);
+  }
+  return true;
 }
 
 /**
  * @brief Decodes display data received from mesh network
  *
+ * Format: "D1,D2,D3,D4,DOT,R,G,B"
+ * Example: "-1,5,4,2,3,255,128,0"
+ *
  * @param data Comma-separated string of display values
  * @param d1-d4 Output parameters for digits
  * @param dot Output parameter for dot mode
@@ -444,8 +1399,19 @@ bool ClockStateMachine::decodeDisplayData(const char* data,
                                           int& r,
                                           int& g,
                                           int& b) {
-  return (sscanf(data, "%d,%d,%d,%d,%d,%d,%d,%d", &d1, &d2, &d3, &d4, &dot, &r,
-                 &g, &b) == 8);
+  // Parsed by hand to keep scanf out of the firmware image
+  int* fields[8] = {&d1, &d2, &d3, &d4, &dot, &r, &g, &b};
+  const char* p = data;
+  for (uint8_t i = 0; i < 8; i++) {
+    char* end;
+    long value = strtol(p, &end, 10);
+    if (end == p || (i < 7 && *end != ',')) {
+      return false;
+    }
+    *fields[i] = (int) value;
+    p = end + 1;
+  }
+  return true;
 }
 
 /**
@@ -453,12 +1419,46 @@ bool ClockStateMachine::decodeDisplayData(const char* data,
  *
  * @param data Encoded string containing display state
  *
- * Decodes the received data and updates the local display to match
- * the received state, keeping all clocks synchronized.
+ * Clocks running older firmware broadcast every rendered frame instead of
+ * the reference time. Runs on the system thread: the decoded frame is only
+ * handed to the loop, see processMeshMessages().
  */
 void ClockStateMachine::recvMeshTime(const char* data) {
-  int d1, d2, d3, d4, dot, r, g, b;
-  if (decodeDisplayData(data, d1, d2, d3, d4, dot, r, g, b)) {
-    display.setTime(d1, d2, d3, d4, dot, r, g, b);
+  FrameMessage m;
+  if (decodeDisplayData(data, m.d1, m.d2, m.d3, m.d4, m.dot, m.r, m.g, m.b)) {
+    frameMailbox.post(m);
+  }
+}
+
+/**
+ * @brief Applies mesh messages received since the last loop
+ *
+ * Mesh callbacks run on the system thread, so they only post decoded
+ * messages to mailboxes and all state and display changes happen here on
+ * the application thread. Only the latest message of each kind is kept.
+ * Messages are ignored while this clock is leading. While sleeping, legacy
+ * frames are shown as is so mixed fleets stay synchronized, and a sync
+ * aligns the local start time with the leader so the state machine can
+ * follow its mode and display options.
+ */
+void ClockStateMachine::processMeshMessages() {
+  bool leading = stateHandler != &stateSleep && stateHandler != &stateFollow;
+
+  ProgramMessage programMessage;
+  if (programMailbox.take(programMessage) && !leading) {
+    program.compile(programMessage.text);
+  }
+
+  SyncMessage sync;
+  if (syncMailbox.take(sync) && !leading) {
+    startTime = sync.receivedAt - sync.elapsedMs;
+    lastSyncReceived = sync.receivedAt;
+    followMode = sync.mode;
+    followOptions = sync.options;
+  }
+
+  FrameMessage m;
+  if (frameMailbox.take(m) && stateHandler == &stateSleep) {
+    display.setTime(m.d1, m.d2, m.d3, m.d4, m.dot, m.r, m.g, m.b);
   }
 }
\ No newline at end of file
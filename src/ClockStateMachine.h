@@ -1,9 +1,15 @@
 #ifndef __CLOCKSTATEMACHINE_H
 #define __CLOCKSTATEMACHINE_H
 
+#include <atomic>
+
 #include "Button.h"
+#include "HueWheel.h"
+#include "LatencyHistogram.h"
+#include "Mailbox.h"
 #include "Particle.h"
 #include "SegmentDisplay.h"
+#include "WorkoutProgram.h"
 
 /**
  * @brief Main control class for the pace clock
@@ -13,9 +19,13 @@
  * - Manual Rainbow: Cycling rainbow colors display of elapsed time
  * - Manual Red: Red color display of elapsed time
  * - Countdown 50: Special countdown mode for swim training
+ * - Program: Runs a workout loaded over serial or the mesh network
  *
  * Handles button inputs, display updates, and mesh network synchronization
- * between multiple clocks.
+ * between multiple clocks. The clock whose power switch is on leads: it
+ * broadcasts its mode and elapsed time when they change (plus a slow
+ * heartbeat), and every other clock follows by rendering the same mode from
+ * its own copy of the start time.
  */
 class ClockStateMachine {
  public:
@@ -28,35 +38,211 @@ class ClockStateMachine {
   void loop();
 
   void recvMeshTime(const char* data);
-  void pushTimeToMesh(
-      int d1, int d2, int d3, int d4, int dot, int r, int g, int b);
+  void recvMeshSync(const char* data);
+  void recvMeshProgram(const char* data);
+  void recvMeshJoin();
+
+  bool loadProgram(const char* text);
+
+  bool setFrameLeadTime(system_tick_t leadMs);
+  void formatFrameErrors(char* buffer, size_t size) const;
+  void formatBootTimes(char* buffer, size_t size) const;
+  void formatTenthsStats(char* buffer, size_t size) const;
+  void formatLatency(char* buffer, size_t size) const;
+  void resetLatency();
+
+  /**
+   * @brief What the Countdown 50 display shows at one point of the session
+   */
+  struct CountdownFrame {
+    bool done = false;          // Session over, display off
+    int group = 0;              // Leftmost digit, 0 for blank
+    uint8_t remainingSec = 0;   // Right two digits
+    int r = 0, g = 0, b = 0;    // Color
+    bool finalSeconds = false;  // Last seconds of a round, display pulses
+  };
+  static CountdownFrame countdownFrame(uint32_t elapsedMs);
+
+  // Sync message encoding/decoding
+  static const uint8_t SYNC_VERSION = 3;
+  static const size_t SYNC_MESSAGE_SIZE = 8;   // Binary bytes
+  static const size_t SYNC_ENCODED_SIZE = 12;  // Base64 chars + terminator
+  static const uint8_t SYNC_OPTION_EFFECT = 0x03;  // Count-up effect type
+  static const uint8_t SYNC_OPTION_TENTHS = 0x04;  // Count-up modes in SS.t
+  static const uint8_t SYNC_OPTIONS =  // Bits in use
+      SYNC_OPTION_EFFECT | SYNC_OPTION_TENTHS;
+  static void encodeSyncData(char* buffer,
+                             uint8_t mode,
+                             uint8_t options,
+                             uint32_t elapsedMs);
+  static bool decodeSyncData(const char* data,
+                             uint8_t& mode,
+                             uint8_t& options,
+                             uint32_t& elapsedMs);
 
  private:
   const int refreshInterval = 500;
 
+  // Animation
+  static const system_tick_t ANIMATION_FRAME_INTERVAL = 20;  // 50 fps
+  static const uint32_t RAINBOW_PERIOD_MS = 240000;  // One turn of the wheel
+  static const uint32_t CHASE_PERIOD_MS = 4000;      // Chase effect turn
+  static const uint32_t PULSE_PERIOD_MS = 1000;      // One pulse per second
+  static const uint8_t PULSE_DEPTH = 192;
+  static const uint8_t FINAL_SECONDS = 10;  // Pulse while this many are left
+  SegmentDisplay::Effect countUpEffect;  // Chosen over serial or synced
+  void setCountUpEffect(uint8_t type);
+  bool animating = false;  // Last frame used an animated effect
+
+  // Tenths display: the count-up modes show SS.t, chosen over serial
+  static const system_tick_t TENTHS_FRAME_INTERVAL = 100;
+  bool showTenths = false;
+
+  // Tenths check: every tenth should be shown once, on its own frame
+  uint32_t tenthsShown = 0;    // Tenth transitions rendered
+  uint32_t tenthsSkipped = 0;  // Tenths never shown
+  uint32_t tenthsDoubled = 0;  // Tenths held past the next boundary
+  uint32_t lastTenth = 0;
+  system_tick_t lastTenthAt = 0;
+  system_tick_t tenthsStartTime = 0;
+  void (*tenthsHandler)(ClockStateMachine&) = nullptr;
+  void recordTenth(uint32_t tenth);
+
+  // Latency of each loop; drawing and showing frames are timed by the display
+  static const system_tick_t LATENCY_VARIABLE_INTERVAL = 10000;
+  LatencyHistogram loopLatency;
+  char latencyVariable[256] = "";  // "latency" cloud variable
+  system_tick_t latencyVariableTime = 0;
+  void updateLatencyVariable();
+
+  // Mesh synchronization
+  static const system_tick_t SYNC_HEARTBEAT_INTERVAL = 60000;
+  static const system_tick_t SYNC_TIMEOUT = 3 * SYNC_HEARTBEAT_INTERVAL;
+
+  // Modes shared with other clocks, each with its own color scheme
+  enum Mode : uint8_t {
+    MODE_SLEEP = 0,
+    MODE_MANUAL_RAINBOW = 1,
+    MODE_MANUAL_RED = 2,
+    MODE_COUNTDOWN_50 = 3,
+    MODE_PROGRAM = 4,
+  };
+
   // Pin definitions
   static const int PIN_POWER = D7;
   static const int PIN_MANUAL_RAINBOW = D4;
   static const int PIN_MANUAL_RED = D5;
   static const int PIN_COUNTDOWN_50 = D6;
+  static const int PIN_STRIP = D8;
+#ifdef PACE_CLOCK_SPLIT_STRIP
+  // Split wiring: the dots and the right-hand digits on their own data lines
+  static const int PIN_STRIP_DOTS = D3;
+  static const int PIN_STRIP_RIGHT = D2;
+#endif
 
   // Hardware components
   Button powerSwitch;
   Button manualRainbowSwitch;
   Button manualRedSwitch;
   Button countdown50Switch;
-  Adafruit_NeoPixel strip;
+  StaticNeoPixel<SegmentDisplay::LED_COUNT, WS2812B> strip;
   SegmentDisplay display;
+  WorkoutProgram program;
 
   // State handlers
   static void stateSleep(ClockStateMachine& csm);
   static void stateManualRainbow(ClockStateMachine& csm);
   static void stateManualRed(ClockStateMachine& csm);
   static void stateCountdown50(ClockStateMachine& csm);
+  static void stateProgram(ClockStateMachine& csm);
+  static void stateFollow(ClockStateMachine& csm);
 
   // State management
   void (*stateHandler)(ClockStateMachine&) = nullptr;
   system_tick_t startTime = 0;
+  bool sleepEntered = false;    // Sleep display drawn since entering sleep
+  bool programEntered = false;  // Switch changes cleared since entering
+
+  // Frame scheduling
+  static const int32_t FRAME_ERROR_MIN_MS = -16;
+  static const int32_t FRAME_ERROR_BUCKET_MS = 2;
+  static const int FRAME_ERROR_BUCKETS = 32;
+  system_tick_t frameLeadTime = 6;  // Render + show() latency budget
+  system_tick_t frameTime = 0;      // Transition the current frame is for
+  system_tick_t nextFrameTime = 0;
+  system_tick_t scheduledStartTime = 0;
+  system_tick_t scheduledInterval = 0;
+  void (*scheduledHandler)(ClockStateMachine&) = nullptr;
+  uint32_t frameErrorHistogram[FRAME_ERROR_BUCKETS] = {};
+  bool framePending = false;          // A frame is still being clocked out
+  system_tick_t pendingFrameTime = 0;  // Transition of that frame
+
+  bool frameDue(system_tick_t interval);
+  system_tick_t frameInterval(uint8_t mode) const;
+  void recordFrameError(int32_t errorMs);
+  void updateFrameError();
+  void renderIfDue(void (ClockStateMachine::*render)(), uint8_t mode);
+
+  // Mesh messages handed from the system thread to the loop
+  struct FrameMessage {
+    int d1, d2, d3, d4, dot, r, g, b;
+  };
+  struct SyncMessage {
+    uint8_t mode;
+    uint8_t options;  // SYNC_OPTION_ bits
+    uint32_t elapsedMs;
+    system_tick_t receivedAt;  // millis() when the message arrived
+  };
+  struct ProgramMessage {
+    char text[WorkoutProgram::MAX_SOURCE + 1];
+  };
+  Mailbox<FrameMessage> frameMailbox;
+  Mailbox<SyncMessage> syncMailbox;
+  Mailbox<ProgramMessage> programMailbox;
+  void processMeshMessages();
+
+  // Mesh synchronization state
+  uint8_t followMode = MODE_SLEEP;  // Mode rendered while following
+  uint8_t followOptions = 0;        // Its display options, SYNC_OPTION_ bits
+  uint8_t syncedMode = MODE_SLEEP;  // Mode last broadcast as leader
+  uint8_t syncedOptions = 0;        // Options last broadcast as leader
+  system_tick_t syncedStartTime = 0;
+  bool programUnsent = false;  // Program loaded but not broadcast yet
+  system_tick_t lastSyncSent = 0;
+  system_tick_t lastSyncReceived = 0;
+  bool meshReady = false;                   // Mesh.ready() as of this loop
+  std::atomic<bool> joinReceived{false};    // Set from the system thread
+
+  // Time to usable display, millis() after boot plus one, 0 until it happens
+  system_tick_t bootLoopTime = 0;
+  system_tick_t bootFrameTime = 0;
+  system_tick_t bootMeshTime = 0;
+
+  // Frame rendering, shared by the leader and followers
+  void renderMode(uint8_t mode);
+  void renderFollowMode();
+  void renderManualRainbow();
+  void renderManualRed();
+  void renderCountdown50();
+  void renderProgram();
+  void showTime(int d1,
+                int d2,
+                int d3,
+                int d4,
+                int dot,
+                int r,
+                int g,
+                int b,
+                const SegmentDisplay::Effect& effect =
+                    SegmentDisplay::Effect());
+  SegmentDisplay::Effect finalSecondsEffect(uint32_t elapsedMs) const;
+
+  // Mesh synchronization
+  uint8_t currentMode() const;
+  uint8_t currentOptions() const;
+  void syncMesh();
+  void updateMeshStatus();
+  void publishSync(uint8_t mode);
 
   // Helper methods
   void resetTime();
@@ -64,21 +250,14 @@ class ClockStateMachine {
   void updateTimeFromMillis(int r, int g, int b);
   void updateTimeDisplay(
       int minutes, int seconds, int r, int g, int b, int dotStatus = 1);
-  void calculateRainbowColor(uint8_t pos, int& r, int& g, int& b);
 
   // Input handling
   void updateButtons();
+  void updateSerial();
+  char serialLine[WorkoutProgram::MAX_SOURCE + 16];
+  size_t serialLength = 0;
 
-  // Display data encoding/decoding
-  void encodeDisplayData(char* buffer,
-                         int d1,
-                         int d2,
-                         int d3,
-                         int d4,
-                         int dot,
-                         int r,
-                         int g,
-                         int b);
+  // Display data decoding (legacy per-frame protocol)
   bool decodeDisplayData(const char* data,
                          int& d1,
                          int& d2,
@@ -0,0 +1,105 @@
+#include "HueWheel.h"
+
+/**
+ * @brief Fully saturated colors at 256 steps of equal OKLab hue angle
+ *
+ * Generated offline by sampling the HSV wheel, converting each color to
+ * OKLab, and picking the colors at evenly spaced hue angles.
+ */
+static const uint8_t HUE_TABLE[256][3] = {
+    {0, 255, 0}, {61, 255, 0}, {86, 255, 0}, {104, 255, 0},
+    {119, 255, 0}, {132, 255, 0}, {143, 255, 0}, {153, 255, 0},
+    {162, 255, 0}, {170, 255, 0}, {178, 255, 0}, {185, 255, 0},
+    {192, 255, 0}, {199, 255, 0}, {205, 255, 0}, {211, 255, 0},
+    {217, 255, 0}, {223, 255, 0}, {228, 255, 0}, {234, 255, 0},
+    {239, 255, 0}, {244, 255, 0}, {249, 255, 0}, {254, 255, 0},
+    {255, 252, 0}, {255, 247, 0}, {255, 243, 0}, {255, 239, 0},
+    {255, 235, 0}, {255, 231, 0}, {255, 227, 0}, {255, 224, 0},
+    {255, 220, 0}, {255, 217, 0}, {255, 214, 0}, {255, 210, 0},
+    {255, 207, 0}, {255, 204, 0}, {255, 201, 0}, {255, 198, 0},
+    {255, 195, 0}, {255, 193, 0}, {255, 190, 0}, {255, 187, 0},
+    {255, 184, 0}, {255, 181, 0}, {255, 179, 0}, {255, 176, 0},
+    {255, 173, 0}, {255, 171, 0}, {255, 168, 0}, {255, 165, 0},
+    {255, 162, 0}, {255, 160, 0}, {255, 157, 0}, {255, 154, 0},
+    {255, 151, 0}, {255, 149, 0}, {255, 146, 0}, {255, 143, 0},
+    {255, 140, 0}, {255, 137, 0}, {255, 133, 0}, {255, 130, 0},
+    {255, 127, 0}, {255, 123, 0}, {255, 120, 0}, {255, 116, 0},
+    {255, 112, 0}, {255, 108, 0}, {255, 104, 0}, {255, 99, 0},
+    {255, 94, 0}, {255, 89, 0}, {255, 83, 0}, {255, 77, 0},
+    {255, 70, 0}, {255, 62, 0}, {255, 52, 0}, {255, 40, 0},
+    {255, 21, 0}, {255, 0, 12}, {255, 0, 28}, {255, 0, 38},
+    {255, 0, 47}, {255, 0, 54}, {255, 0, 61}, {255, 0, 67},
+    {255, 0, 73}, {255, 0, 78}, {255, 0, 83}, {255, 0, 88},
+    {255, 0, 93}, {255, 0, 98}, {255, 0, 103}, {255, 0, 107},
+    {255, 0, 112}, {255, 0, 116}, {255, 0, 121}, {255, 0, 125},
+    {255, 0, 130}, {255, 0, 134}, {255, 0, 139}, {255, 0, 144},
+    {255, 0, 148}, {255, 0, 153}, {255, 0, 157}, {255, 0, 162},
+    {255, 0, 167}, {255, 0, 172}, {255, 0, 177}, {255, 0, 182},
+    {255, 0, 187}, {255, 0, 192}, {255, 0, 197}, {255, 0, 202},
+    {255, 0, 208}, {255, 0, 213}, {255, 0, 219}, {255, 0, 225},
+    {255, 0, 231}, {255, 0, 237}, {255, 0, 243}, {255, 0, 250},
+    {254, 0, 255}, {247, 0, 255}, {241, 0, 255}, {235, 0, 255},
+    {229, 0, 255}, {223, 0, 255}, {217, 0, 255}, {211, 0, 255},
+    {206, 0, 255}, {200, 0, 255}, {195, 0, 255}, {190, 0, 255},
+    {185, 0, 255}, {180, 0, 255}, {175, 0, 255}, {170, 0, 255},
+    {165, 0, 255}, {161, 0, 255}, {156, 0, 255}, {151, 0, 255},
+    {147, 0, 255}, {142, 0, 255}, {138, 0, 255}, {134, 0, 255},
+    {129, 0, 255}, {125, 0, 255}, {121, 0, 255}, {116, 0, 255},
+    {112, 0, 255}, {108, 0, 255}, {104, 0, 255}, {99, 0, 255},
+    {95, 0, 255}, {91, 0, 255}, {86, 0, 255}, {82, 0, 255},
+    {77, 0, 255}, {72, 0, 255}, {67, 0, 255}, {62, 0, 255},
+    {56, 0, 255}, {50, 0, 255}, {43, 0, 255}, {36, 0, 255},
+    {26, 0, 255}, {12, 0, 255}, {0, 73, 255}, {0, 92, 255},
+    {0, 103, 255}, {0, 113, 255}, {0, 120, 255}, {0, 127, 255},
+    {0, 133, 255}, {0, 138, 255}, {0, 143, 255}, {0, 147, 255},
+    {0, 151, 255}, {0, 155, 255}, {0, 159, 255}, {0, 163, 255},
+    {0, 166, 255}, {0, 169, 255}, {0, 172, 255}, {0, 176, 255},
+    {0, 178, 255}, {0, 181, 255}, {0, 184, 255}, {0, 187, 255},
+    {0, 189, 255}, {0, 192, 255}, {0, 195, 255}, {0, 197, 255},
+    {0, 200, 255}, {0, 202, 255}, {0, 204, 255}, {0, 207, 255},
+    {0, 209, 255}, {0, 211, 255}, {0, 214, 255}, {0, 216, 255},
+    {0, 218, 255}, {0, 221, 255}, {0, 223, 255}, {0, 225, 255},
+    {0, 228, 255}, {0, 230, 255}, {0, 233, 255}, {0, 235, 255},
+    {0, 237, 255}, {0, 240, 255}, {0, 242, 255}, {0, 245, 255},
+    {0, 247, 255}, {0, 250, 255}, {0, 253, 255}, {0, 255, 255},
+    {0, 255, 252}, {0, 255, 249}, {0, 255, 246}, {0, 255, 243},
+    {0, 255, 241}, {0, 255, 238}, {0, 255, 235}, {0, 255, 232},
+    {0, 255, 229}, {0, 255, 226}, {0, 255, 223}, {0, 255, 219},
+    {0, 255, 216}, {0, 255, 213}, {0, 255, 209}, {0, 255, 206},
+    {0, 255, 202}, {0, 255, 199}, {0, 255, 195}, {0, 255, 191},
+    {0, 255, 186}, {0, 255, 182}, {0, 255, 177}, {0, 255, 172},
+    {0, 255, 167}, {0, 255, 162}, {0, 255, 156}, {0, 255, 149},
+    {0, 255, 142}, {0, 255, 135}, {0, 255, 126}, {0, 255, 117},
+    {0, 255, 106}, {0, 255, 93}, {0, 255, 77}, {0, 255, 55},
+};
+
+/**
+ * @brief Converts a hue to RGB
+ *
+ * @param hue Position on the wheel, FULL_TURN units per revolution
+ * @param r Output parameter for red (0-255)
+ * @param g Output parameter for green (0-255)
+ * @param b Output parameter for blue (0-255)
+ */
+void HueWheel::toRgb(uint16_t hue, int& r, int& g, int& b) {
+  const uint8_t* from = HUE_TABLE[hue >> 8];
+  const uint8_t* to = HUE_TABLE[(uint8_t) ((hue >> 8) + 1)];
+  int frac = hue & 0xFF;
+
+  r = from[0] + (((to[0] - from[0]) * frac) >> 8);
+  g = from[1] + (((to[1] - from[1]) * frac) >> 8);
+  b = from[2] + (((to[2] - from[2]) * frac) >> 8);
+}
+
+/**
+ * @brief Hue for a point in an animation that turns the wheel once per
+ * period
+ *
+ * @param elapsedMs Time since the animation started
+ * @param periodMs Time for one revolution
+ * @return Hue in FULL_TURN units
+ */
+uint16_t HueWheel::fromTime(uint32_t elapsedMs, uint32_t periodMs) {
+  return (uint16_t) (((uint64_t) (elapsedMs % periodMs) * FULL_TURN) /
+                     periodMs);
+}
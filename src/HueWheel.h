@@ -0,0 +1,24 @@
+#ifndef __HUEWHEEL_H
+#define __HUEWHEEL_H
+
+#include "Particle.h"
+
+/**
+ * @brief Fixed-point rainbow color wheel
+ *
+ * Hues are 16-bit fixed point: the top 8 bits select one of 256 colors in a
+ * table held in flash and the low 8 bits blend towards the next one, so the
+ * wheel can be animated in steps much finer than a table entry without any
+ * floating point. The table is spaced evenly in perceived hue (OKLab hue
+ * angle) over fully saturated colors, starting at green and running through
+ * yellow, red, magenta, blue and cyan.
+ */
+class HueWheel {
+ public:
+  static const uint32_t FULL_TURN = 65536;  // Hue units per revolution
+
+  static void toRgb(uint16_t hue, int& r, int& g, int& b);
+  static uint16_t fromTime(uint32_t elapsedMs, uint32_t periodMs);
+};
+
+#endif /* __HUEWHEEL_H */
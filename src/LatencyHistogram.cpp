@@ -0,0 +1,91 @@
+#include "LatencyHistogram.h"
+
+/**
+ * @brief Counts one duration
+ *
+ * @param ticks Duration in System.ticks()
+ */
+void LatencyHistogram::recordTicks(uint32_t ticks) {
+  buckets[ticks ? 32 - __builtin_clz(ticks) : 0]++;
+  samples++;
+  if (ticks < minTicks) {
+    minTicks = ticks;
+  }
+  if (ticks > maxTicks) {
+    maxTicks = ticks;
+  }
+}
+
+/**
+ * @brief Forgets every duration recorded so far
+ */
+void LatencyHistogram::reset() {
+  memset(buckets, 0, sizeof(buckets));
+  samples = 0;
+  minTicks = UINT32_MAX;
+  maxTicks = 0;
+}
+
+/**
+ * @brief Duration that 'percent' percent of the samples do not exceed
+ *
+ * Rounded up to the end of its bucket, but never outside min..max.
+ *
+ * @param percent Percentile, 0-100
+ * @return Duration in ticks, 0 if nothing was recorded
+ */
+uint32_t LatencyHistogram::percentileTicks(uint8_t percent) const {
+  if (!samples) {
+    return 0;
+  }
+  // Rank of the sample, rounded up, and at least the first one
+  uint32_t rank = (uint32_t) (((uint64_t) samples * percent + 99) / 100);
+  if (rank == 0) {
+    rank = 1;
+  }
+
+  uint32_t seen = 0;
+  int i = 0;
+  for (; i < BUCKETS - 1; i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      break;
+    }
+  }
+  uint32_t upper = i ? (uint32_t) (((uint64_t) 1 << i) - 1) : 0;
+  if (upper < minTicks) {
+    upper = minTicks;
+  }
+  if (upper > maxTicks) {
+    upper = maxTicks;
+  }
+  return upper;
+}
+
+/**
+ * @brief Formats the sample count and the min, p50, p99 and max durations
+ *
+ * Durations are in microseconds with one decimal.
+ * Format: "n COUNT,min US,p50 US,p99 US,max US", or "n 0" when empty
+ * Example: "n 7200,min 3.1,p50 7.9,p99 15.9,max 41.0"
+ *
+ * @param buffer Output buffer
+ * @param size Size of the output buffer
+ */
+void LatencyHistogram::format(char* buffer, size_t size) const {
+  if (!samples) {
+    snprintf(buffer, size, "n 0");
+    return;
+  }
+  const uint32_t ticks[] = {minTicks, percentileTicks(50),
+                            percentileTicks(99), maxTicks};
+  const char* names[] = {"min", "p50", "p99", "max"};
+  uint32_t ticksPerUs = System.ticksPerMicrosecond();
+  size_t len = snprintf(buffer, size, "n %lu", (unsigned long) samples);
+  for (int i = 0; i < 4 && len < size; i++) {
+    uint64_t tenths = (uint64_t) ticks[i] * 10 / ticksPerUs;
+    len += snprintf(buffer + len, size - len, ",%s %lu.%lu", names[i],
+                    (unsigned long) (tenths / 10),
+                    (unsigned long) (tenths % 10));
+  }
+}
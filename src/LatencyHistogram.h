@@ -0,0 +1,55 @@
+#ifndef __LATENCYHISTOGRAM_H
+#define __LATENCYHISTOGRAM_H
+
+#include "Particle.h"
+
+/**
+ * @brief Fixed-size log2 histogram of how long a piece of code takes
+ *
+ * Durations are measured in System.ticks(), the DWT cycle counter on the
+ * nRF52840 (64 ticks per microsecond) and a monotonic nanosecond clock on
+ * the host simulator. Bucket i counts durations below 2^i ticks (and at or
+ * above 2^(i-1)), so recording is a count-leading-zeros and an increment,
+ * with no allocation. Percentiles are read back as the upper bound of their
+ * bucket, within a factor of two; min and max are exact.
+ *
+ * Usage:
+ *   uint32_t start = LatencyHistogram::now();
+ *   ...
+ *   histogram.record(start);
+ */
+class LatencyHistogram {
+ public:
+  static const int BUCKETS = 33;  // Zero, then one per bit of the tick count
+
+  /**
+   * @brief Current tick count, for passing to record() later
+   */
+  static uint32_t now() {
+    return System.ticks();
+  }
+
+  /**
+   * @brief Records the time from 'start' (a now() value) until now
+   */
+  void record(uint32_t start) {
+    recordTicks(now() - start);
+  }
+
+  void recordTicks(uint32_t ticks);
+  void reset();
+
+  uint32_t count() const {
+    return samples;
+  }
+  uint32_t percentileTicks(uint8_t percent) const;
+  void format(char* buffer, size_t size) const;
+
+ private:
+  uint32_t buckets[BUCKETS] = {};
+  uint32_t samples = 0;
+  uint32_t minTicks = UINT32_MAX;
+  uint32_t maxTicks = 0;
+};
+
+#endif /* __LATENCYHISTOGRAM_H */
@@ -0,0 +1,58 @@
+#ifndef __MAILBOX_H
+#define __MAILBOX_H
+
+#include <atomic>
+
+/**
+ * @brief Lock-free latest-value mailbox between two threads
+ *
+ * A triple buffer: the producer always has a slot of its own to write to and
+ * the consumer always has a slot of its own to read from, and the two swap
+ * through a shared middle slot with a single atomic exchange. Neither side
+ * ever waits or sees a partially written value. If several values are
+ * posted before the consumer takes one, only the latest is delivered.
+ *
+ * Safe for exactly one producer thread and one consumer thread.
+ */
+template <typename T>
+class Mailbox {
+ public:
+  /**
+   * @brief Publishes a value, replacing any value not yet taken
+   * @param value Value to copy into the mailbox
+   *
+   * Producer side only.
+   */
+  void post(const T& value) {
+    slots[back] = value;
+    back = middle.exchange(back | FRESH, std::memory_order_acq_rel) &
+           INDEX_MASK;
+  }
+
+  /**
+   * @brief Takes the latest value, if a new one was posted
+   * @param value Output parameter for the value
+   * @return true if a value was taken, false if nothing new was posted
+   *
+   * Consumer side only.
+   */
+  bool take(T& value) {
+    if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+      return false;
+    }
+    front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+    value = slots[front];
+    return true;
+  }
+
+ private:
+  static const uint8_t INDEX_MASK = 0x03;  // Slot index bits of 'middle'
+  static const uint8_t FRESH = 0x04;  // Set in 'middle' when not yet taken
+
+  T slots[3];
+  uint8_t back = 0;                // Owned by the producer
+  std::atomic<uint8_t> middle{1};  // Shared, slot index plus FRESH
+  uint8_t front = 2;               // Owned by the consumer
+};
+
+#endif /* __MAILBOX_H */
@@ -3,78 +3,153 @@
 static Logger log("segment_display");
 
 /**
- * @brief Lookup table for 7-segment digit patterns
+ * @brief Segment bits of a glyph mask
  *
- * Each row represents a digit (0-9) and contains 7 values for segments a-g.
- * 1 means the segment is on, 0 means off.
- * Segment layout:
- *   f
- * e   g
- *   a
- * d   b
+ * Segment layout, as the digit patterns light it:
  *   c
+ * d   b
+ *   a
+ * e   g
+ *   f
  */
-const uint8_t DIGIT_PATTERNS[10][7] = {
-    {0, 1, 1, 1, 1, 1, 1},  // 0
-    {0, 1, 0, 0, 0, 0, 1},  // 1
-    {1, 1, 1, 0, 1, 1, 0},  // 2
-    {1, 1, 1, 0, 0, 1, 1},  // 3
-    {1, 1, 0, 1, 0, 0, 1},  // 4
-    {1, 0, 1, 1, 0, 1, 1},  // 5
-    {1, 0, 1, 1, 1, 1, 1},  // 6
-    {0, 1, 1, 0, 0, 0, 1},  // 7
-    {1, 1, 1, 1, 1, 1, 1},  // 8
-    {1, 1, 1, 1, 0, 0, 1}   // 9
-};
+static const uint8_t SEG_A = 1 << 0;
+static const uint8_t SEG_B = 1 << 1;
+static const uint8_t SEG_C = 1 << 2;
+static const uint8_t SEG_D = 1 << 3;
+static const uint8_t SEG_E = 1 << 4;
+static const uint8_t SEG_F = 1 << 5;
+static const uint8_t SEG_G = 1 << 6;
 
 /**
- * @brief LED mapping for each digit position
+ * @brief Segment masks of the glyphs, indexed by glyph code
  *
- * Defines the LED ranges for each segment of each digit.
- * Each digit has 7 segments, and each segment consists of multiple LEDs.
- * segments[7][2] contains [start,end] LED indices for each segment.
+ * Codes 0-9 are the digits; the letters and symbols follow in the order of
+ * SegmentDisplay::Glyph and GLYPH_CHARS.
  */
-const struct {
-  uint16_t start;
-  uint16_t segments[7][2];  // [segment_index][start,end]
-} DIGIT_POSITIONS[4] = {
-    {0,
-     {{0, 5},
-      {6, 11},
-      {12, 17},
-      {18, 23},
-      {24, 29},
-      {30, 35},
-      {36, 41}}},  // Digit 1
-    {42,
-     {{42, 47},
-      {48, 53},
-      {54, 59},
-      {60, 65},
-      {66, 71},
-      {72, 77},
-      {78, 83}}},  // Digit 2
-    {92,
-     {{92, 97},
-      {98, 103},
-      {104, 109},
-      {110, 115},
-      {116, 121},
-      {122, 127},
-      {128, 133}}},  // Digit 3
-    {134,
-     {{134, 139},
-      {140, 145},
-      {146, 151},
-      {152, 157},
-      {158, 163},
-      {164, 169},
-      {170, 175}}}  // Digit 4
+static const uint8_t GLYPH_MASKS[] = {
+    SEG_B | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G,          // 0
+    SEG_B | SEG_G,                                          // 1
+    SEG_A | SEG_B | SEG_C | SEG_E | SEG_F,                  // 2
+    SEG_A | SEG_B | SEG_C | SEG_F | SEG_G,                  // 3
+    SEG_A | SEG_B | SEG_D | SEG_G,                          // 4
+    SEG_A | SEG_C | SEG_D | SEG_F | SEG_G,                  // 5
+    SEG_A | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G,          // 6
+    SEG_B | SEG_C | SEG_G,                                  // 7
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G,  // 8
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_G,                  // 9
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_G,          // A
+    SEG_A | SEG_D | SEG_E | SEG_F | SEG_G,                  // b
+    SEG_C | SEG_D | SEG_E | SEG_F,                          // C
+    SEG_A | SEG_E | SEG_F,                                  // c
+    SEG_A | SEG_B | SEG_E | SEG_F | SEG_G,                  // d
+    SEG_A | SEG_C | SEG_D | SEG_E | SEG_F,                  // E
+    SEG_A | SEG_C | SEG_D | SEG_E,                          // F
+    SEG_C | SEG_D | SEG_E | SEG_F | SEG_G,                  // G
+    SEG_A | SEG_B | SEG_D | SEG_E | SEG_G,                  // H
+    SEG_A | SEG_D | SEG_E | SEG_G,                          // h
+    SEG_D | SEG_E,                                          // I
+    SEG_B | SEG_E | SEG_F | SEG_G,                          // J
+    SEG_D | SEG_E | SEG_F,                                  // L
+    SEG_A | SEG_E | SEG_G,                                  // n
+    SEG_A | SEG_E | SEG_F | SEG_G,                          // o
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_E,                  // P
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_G,                  // q
+    SEG_A | SEG_E,                                          // r
+    SEG_A | SEG_D | SEG_E | SEG_F,                          // t
+    SEG_B | SEG_D | SEG_E | SEG_F | SEG_G,                  // U
+    SEG_E | SEG_F | SEG_G,                                  // u
+    SEG_A | SEG_B | SEG_D | SEG_F | SEG_G,                  // y
+    SEG_A,                                                  // -
+    SEG_F,                                                  // _
+    SEG_A | SEG_B | SEG_C | SEG_D,                          // degree sign
 };
 
+static const uint8_t GLYPH_COUNT = sizeof(GLYPH_MASKS) / sizeof(GLYPH_MASKS[0]);
+
+/**
+ * @brief Characters of the glyphs from code 10 on, '*' for the degree sign
+ */
+static const char GLYPH_CHARS[] = "AbCcdEFGHhIJLnoPqrtUuy-_*";
+
+static_assert(sizeof(GLYPH_CHARS) - 1 == GLYPH_COUNT - 10,
+              "one character per letter or symbol glyph");
+static_assert(SegmentDisplay::GLYPH_DEGREE == GLYPH_COUNT - 1,
+              "Glyph codes follow GLYPH_MASKS");
+
+typedef SegmentDisplay::Layout Layout;
+typedef Layout::Tables LayoutTables;
+
+static_assert(Layout::DIGITS == 4, "setTime() drives four digits");
+static_assert(Layout::SEPARATOR_LEDS == 8, "dot patterns are 8 LEDs wide");
+
+/**
+ * @brief Segment mask of a glyph code
+ *
+ * @param value Digit 0-9 or glyph code (see SegmentDisplay::Glyph)
+ * @return Mask with bit n set for segment n (a-g), 0 (blank) for -1 and
+ *         any code out of range
+ */
+uint8_t SegmentDisplay::glyphMask(int value) {
+  return value >= 0 && value < GLYPH_COUNT ? GLYPH_MASKS[value] : 0;
+}
+
+/**
+ * @brief Glyph code of a character
+ *
+ * Letters without a glyph of their own case use the other case's; 'S' and
+ * 'O' are the digits 5 and 0, and ' ' is blank.
+ *
+ * @param c Character
+ * @return Glyph code, GLYPH_BLANK if the character cannot be shown
+ */
+int8_t SegmentDisplay::glyphFor(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c == 'S' || c == 's') {
+    return 5;
+  }
+  if (c == 'O') {
+    return 0;
+  }
+  const char* match = strchr(GLYPH_CHARS, c);
+  if (!match && c >= 'a' && c <= 'z') {
+    match = strchr(GLYPH_CHARS, c - 'a' + 'A');
+  } else if (!match && c >= 'A' && c <= 'Z') {
+    match = strchr(GLYPH_CHARS, c - 'A' + 'a');
+  }
+  return match && c != '\0' ? 10 + (match - GLYPH_CHARS) : GLYPH_BLANK;
+}
+
+/**
+ * @brief Compares two effect descriptors field by field
+ */
+static bool sameEffect(const SegmentDisplay::Effect& a,
+                       const SegmentDisplay::Effect& b) {
+  return a.type == b.type && a.r2 == b.r2 && a.g2 == b.g2 && a.b2 == b.b2 &&
+         a.phase == b.phase && a.depth == b.depth;
+}
+
+/**
+ * @brief Sets the effect used from the next setTime() on
+ *
+ * @param newEffect Effect descriptor, copied
+ */
+void SegmentDisplay::setEffect(const Effect& newEffect) {
+  effect = newEffect;
+}
+
 /**
  * @brief Updates the display with new time and color values
  *
+ * Only digits and dots that differ from the last frame are rewritten, and
+ * the strip is not refreshed at all when the frame is unchanged. The time
+ * spent drawing and in showAsync() is recorded separately (see
+ * getRenderLatency() and getShowLatency()).
+ *
+ * Digits are 0-9 or a glyph code (see Glyph); -1 or any value without a
+ * glyph shows a blank digit.
+ *
  * @param d1 First digit (leftmost)
  * @param d2 Second digit
  * @param d3 Third digit
@@ -86,46 +161,130 @@ const struct {
  */
 void SegmentDisplay::setTime(
     int d1, int d2, int d3, int d4, int dot, int r, int g, int b) {
-  log.info("SegmentDisplay::setTime()");
+  uint32_t start = LatencyHistogram::now();
+
+  // A color or effect change repaints every lit segment
+  bool repaint = !frameValid || r != curr_r || g != curr_g || b != curr_b ||
+                 !sameEffect(effect, currEffect);
+  bool changed = repaint;
+  currEffect = effect;
 
   // Store current state
   curr_r = r;
   curr_g = g;
   curr_b = b;
 
-  // Update each digit
-  updateDigit(0, d1);
-  updateDigit(1, d2);
-  updateDigit(2, d3);
-  updateDigit(3, d4);
+  // Update each digit that changed
+  const int digits[4] = {d1, d2, d3, d4};
+  for (uint8_t i = 0; i < 4; i++) {
+    if (repaint || digits[i] != curr_digits[i]) {
+      curr_digits[i] = digits[i];
+      updateDigit(i, digits[i]);
+      changed = true;
+    }
+  }
 
   // Update dots based on mode
-  updateDots(dot);
+  if (repaint || dot != curr_dot) {
+    curr_dot = dot;
+    updateDots(dot);
+    changed = true;
+  }
 
-  strip.show();
+  if (!changed) {
+    framesSkipped++;
+    renderLatency.record(start);
+    return;
+  }
+
+  frameValid = true;
+  framesSent++;
+  log.trace("SegmentDisplay::setTime() sent %lu, skipped %lu",
+            (unsigned long) framesSent, (unsigned long) framesSkipped);
+
+  renderLatency.record(start);
+
+  // Return while the frame is clocked out; the next show waits for it
+  start = LatencyHistogram::now();
+  strip.showAsync();
+  showLatency.record(start);
 }
 
-void SegmentDisplay::updateDigit(uint8_t position, int8_t value) {
-  // Handle blank digit case
-  const uint8_t* pattern = value == -1 ? nullptr : DIGIT_PATTERNS[value];
+/**
+ * @brief Draws one digit
+ *
+ * Clears the digit's LEDs in one fill, then paints each lit segment as a
+ * single run, visiting only the bits set in the glyph mask.
+ *
+ * @param position Digit index, 0 for the leftmost
+ * @param value Digit 0-9 or glyph code, anything else is blank
+ */
+void SegmentDisplay::updateDigit(uint8_t position, int value) {
+  paint(Layout::digitFirst(position), Layout::DIGIT_LEDS, false);
 
-  // Update each segment for this digit
-  for (int segment = 0; segment < 7; segment++) {
-    bool isOn = pattern ? pattern[segment] : 0;
-    uint16_t start = DIGIT_POSITIONS[position].segments[segment][0];
-    uint16_t end = DIGIT_POSITIONS[position].segments[segment][1];
+  const SegmentRun* runs = LayoutTables::RUNS + position * Layout::SEGMENTS;
+  for (uint8_t mask = glyphMask(value); mask; mask &= mask - 1) {
+    const SegmentRun& run = runs[__builtin_ctz(mask)];
+    paint(run.first, run.count, true);
+  }
+}
 
-    for (uint16_t i = start; i <= end; i++) {
-      strip.setPixelColor(i, isOn ? strip.Color(curr_r, curr_g, curr_b) : 0);
+/**
+ * @brief Paints a run of LEDs with the current effect, or turns it off
+ *
+ * Effects that give every LED the same color shade the run once and fill
+ * it; the others shade each LED from its coordinates.
+ */
+void SegmentDisplay::paint(uint16_t first, uint16_t count, bool isOn) {
+  if (!isOn) {
+    strip.fill(first, count, 0);
+  } else if (currEffect.type == Effect::SOLID ||
+             currEffect.type == Effect::PULSE) {
+    strip.fill(first, count, shade(first));
+  } else {
+    for (uint16_t led = first; led < first + count; led++) {
+      strip.setPixelColor(led, shade(led));
     }
   }
 }
 
-void SegmentDisplay::updateDots(uint8_t mode) {
-  // Dot LED positions
-  const uint16_t DOT_LEDS[] = {84, 85, 86, 87, 88, 89, 90, 91};
-  const uint8_t DOT_COUNT = sizeof(DOT_LEDS) / sizeof(DOT_LEDS[0]);
+/**
+ * @brief Computes the color of one lit LED under the current effect
+ *
+ * @param led LED index
+ * @return Packed RGB color
+ */
+uint32_t SegmentDisplay::shade(uint16_t led) const {
+  int r = curr_r, g = curr_g, b = curr_b;
+
+  switch (currEffect.type) {
+    case Effect::GRADIENT: {
+      int x = LayoutTables::LED_X[led];
+      r += ((currEffect.r2 - r) * x) >> 8;
+      g += ((currEffect.g2 - g) * x) >> 8;
+      b += ((currEffect.b2 - b) * x) >> 8;
+    } break;
+    case Effect::CHASE: {
+      uint16_t hue = currEffect.phase + (LayoutTables::LED_PATH[led] << 8);
+      HueWheel::toRgb(hue, r, g, b);
+    } break;
+    case Effect::PULSE: {
+      // Triangle wave: full brightness at phase 0, dimmest halfway
+      uint16_t phase = currEffect.phase;
+      int wave = (phase < 0x8000 ? phase : 0xFFFF - phase) >> 7;
+      int level = 256 - ((currEffect.depth * wave) >> 8);
+      r = (r * level) >> 8;
+      g = (g * level) >> 8;
+      b = (b * level) >> 8;
+    } break;
+    case Effect::SOLID:
+    default:
+      break;
+  }
+  return strip.Color(r, g, b);
+}
 
+void SegmentDisplay::updateDots(uint8_t mode) {
   // Define dot patterns for different modes
   bool patterns[5][8] = {
       {1, 1, 0, 0, 0, 0, 0, 0},  // Mode 1, bottom 1/2 dot (ms)
@@ -139,62 +298,103 @@ void SegmentDisplay::updateDots(uint8_t mode) {
   if (mode < 1 || mode > 5)
     return;
 
-  // Apply the pattern
+  // Apply the pattern to every separator, painting each run of equal dots
+  // at once (a separator's LEDs are contiguous)
   const bool* pattern = patterns[mode - 1];
-  for (uint8_t i = 0; i < DOT_COUNT; i++) {
-    strip.setPixelColor(DOT_LEDS[i],
-                        pattern[i] ? strip.Color(curr_r, curr_g, curr_b) : 0);
+  for (uint8_t digit = 0; digit < Layout::DIGITS; digit++) {
+    if (!Layout::hasSeparator(digit)) {
+      continue;
+    }
+    uint16_t first = Layout::separatorFirst(digit);
+    uint8_t runStart = 0;
+    for (uint8_t i = 1; i <= Layout::SEPARATOR_LEDS; i++) {
+      if (i == Layout::SEPARATOR_LEDS || pattern[i] != pattern[runStart]) {
+        paint(first + runStart, i - runStart, pattern[runStart]);
+        runStart = i;
+      }
+    }
   }
 }
 
-void SegmentDisplay::loading() {
-  // Dark blue color
-  curr_r = 0;
-  curr_g = 0;
-  curr_b = 64;
-
-  // Light up sequence
-  for (int digit = 0; digit < 4; digit++) {
-    uint16_t start = DIGIT_POSITIONS[digit].segments[0][0];
-    uint16_t end = DIGIT_POSITIONS[digit].segments[0][1];
+/**
+ * @brief Loading animation timeline: segment a of each digit and the center
+ * dots light up one step at a time, pause, then go out in the same order
+ */
+static const uint8_t LOADING_STEPS =
+    Layout::DIGITS * Layout::LEDS_PER_SEGMENT + Layout::SEPARATOR_COUNT;
+static const system_tick_t LOADING_STEP_MS = 15;
+static const system_tick_t LOADING_PAUSE_MS = 100;  // At full illumination
 
-    for (uint16_t i = start; i <= end; i++) {
-      strip.setPixelColor(i, curr_r, curr_g, curr_b);
-      strip.show();
-      delay(15);
+/**
+ * @brief LEDs drawn by one step of the loading animation
+ *
+ * One LED of segment a per step, digit by digit, and the center pair of
+ * each separator's dots after the digit it follows.
+ *
+ * @param step Step within the light-up (or turn-off) half, 0 to
+ *        LOADING_STEPS - 1
+ * @param first Output parameter for the first LED
+ * @param count Output parameter for the number of LEDs, 0 past the end
+ */
+static void loadingLeds(uint8_t step, uint16_t& first, uint8_t& count) {
+  first = 0;
+  count = 0;
+  for (uint8_t digit = 0; digit < Layout::DIGITS; digit++) {
+    if (step < Layout::LEDS_PER_SEGMENT) {
+      first = LayoutTables::RUNS[digit * Layout::SEGMENTS].first + step;
+      count = 1;
+      return;
     }
-
-    // Center dots
-    if (digit == 1) {
-      strip.setPixelColor(87, curr_r, curr_g, curr_b);
-      strip.setPixelColor(88, curr_r, curr_g, curr_b);
-      strip.show();
-      delay(15);
+    step -= Layout::LEDS_PER_SEGMENT;
+    if (Layout::hasSeparator(digit)) {
+      if (step == 0) {
+        first = Layout::separatorFirst(digit) + Layout::SEPARATOR_LEDS / 2 - 1;
+        count = 2;
+        return;
+      }
+      step--;
     }
   }
+}
 
-  delay(100);  // Pause at full illumination
+/**
+ * @brief Advances the loading animation
+ *
+ * Draws at most one step per call, once the previous step's time is up,
+ * so it can run from the loop without blocking it. The animation repeats
+ * until the display is drawn with setTime() again.
+ *
+ * @param now Current time in milliseconds
+ */
+void SegmentDisplay::loading(system_tick_t now) {
+  // The animation draws on the strip directly
+  if (frameValid) {
+    frameValid = false;
+    loadingStep = 0;
+    loadingNext = now;
+    strip.clear();
+  }
+  if ((int32_t) (now - loadingNext) < 0) {
+    return;
+  }
 
-  // Turn off sequence
-  for (int digit = 0; digit < 4; digit++) {
-    uint16_t start = DIGIT_POSITIONS[digit].segments[0][0];
-    uint16_t end = DIGIT_POSITIONS[digit].segments[0][1];
+  // Dark blue color
+  curr_r = 0;
+  curr_g = 0;
+  curr_b = 64;
 
-    for (uint16_t i = start; i <= end; i++) {
-      strip.setPixelColor(i, 0, 0, 0);
-      strip.show();
-      delay(15);
-    }
+  bool lightUp = loadingStep < LOADING_STEPS;
+  uint16_t first;
+  uint8_t count;
+  loadingLeds(loadingStep % LOADING_STEPS, first, count);
+  strip.fill(first, count, lightUp ? strip.Color(curr_r, curr_g, curr_b) : 0);
+  uint32_t start = LatencyHistogram::now();
+  strip.show();
+  showLatency.record(start);
 
-    // Center dots
-    if (digit == 1) {
-      strip.setPixelColor(87, 0, 0, 0);
-      strip.setPixelColor(88, 0, 0, 0);
-      strip.show();
-      delay(15);
-    }
+  loadingNext = now + LOADING_STEP_MS;
+  if (loadingStep == LOADING_STEPS - 1) {
+    loadingNext += LOADING_PAUSE_MS;
   }
-
-  strip.clear();
-  strip.show();
-}
\ No newline at end of file
+  loadingStep = (loadingStep + 1) % (2 * LOADING_STEPS);
+}
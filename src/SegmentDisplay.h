@@ -3,17 +3,20 @@
 
 #include <neopixel.h>
 
+#include "HueWheel.h"
+#include "LatencyHistogram.h"
 #include "Particle.h"
+#include "SegmentLayout.h"
 
 /**
  * @brief Controls a 4-digit seven-segment display made of NeoPixels
  *
  * Manages a strip of WS2812B LEDs arranged as four 7-segment digits plus
  * separator dots. Handles:
- * - Converting decimal digits to segment patterns
+ * - Converting digits, letters and symbols to segment masks
  * - Managing LED colors and brightness
  * - Different dot display patterns
- * - Loading/startup animations
+ * - Loading/startup animation, drawn incrementally from the loop
  *
  * The display is arranged as:
  * [D1] [D2] [dots] [D3] [D4]
@@ -21,18 +24,137 @@
  */
 class SegmentDisplay {
  public:
+  /**
+   * @brief LED layout of the clock: 4 digits of 6 LEDs per segment, wired
+   * a to g, with 8 dot LEDs after the second digit
+   */
+  typedef SegmentLayout<4, 6, 0x02, 8, 0, 1, 2, 3, 4, 5, 6> Layout;
+  static const uint16_t LED_COUNT = Layout::LED_COUNT;
+
+  /**
+   * @brief Per-pixel color effect applied to the lit LEDs
+   *
+   * Colors are computed from the frame color passed to setTime() and the
+   * position of each LED, with integer math only.
+   */
+  struct Effect {
+    enum Type : uint8_t {
+      SOLID,     // Every lit LED in the frame color
+      GRADIENT,  // Frame color on the left, fading to r2, g2, b2 on the right
+      CHASE,     // Rainbow running along the segments of each digit
+      PULSE,     // Frame color, dimmed by 'depth' halfway through each turn
+    };
+
+    Type type = SOLID;
+    uint8_t r2 = 0, g2 = 0, b2 = 0;  // GRADIENT end color
+    uint16_t phase = 0;  // CHASE hue offset or PULSE position, 65536 a turn
+    uint8_t depth = 0;   // PULSE dimming at the bottom of the pulse, 0-255
+  };
+
+  /**
+   * @brief Glyph codes for letters and symbols, shown like digits 0-9
+   *
+   * For lap counters and error codes. Use glyphFor() to look one up by
+   * character.
+   */
+  enum Glyph : int8_t {
+    GLYPH_BLANK = -1,
+    GLYPH_A = 10,
+    GLYPH_B_LOWER,
+    GLYPH_C,
+    GLYPH_C_LOWER,
+    GLYPH_D_LOWER,
+    GLYPH_E,
+    GLYPH_F,
+    GLYPH_G,
+    GLYPH_H,
+    GLYPH_H_LOWER,
+    GLYPH_I,
+    GLYPH_J,
+    GLYPH_L,
+    GLYPH_N_LOWER,
+    GLYPH_O_LOWER,
+    GLYPH_P,
+    GLYPH_Q_LOWER,
+    GLYPH_R_LOWER,
+    GLYPH_T_LOWER,
+    GLYPH_U,
+    GLYPH_U_LOWER,
+    GLYPH_Y_LOWER,
+    GLYPH_DASH,
+    GLYPH_UNDERSCORE,
+    GLYPH_DEGREE,
+  };
+
   SegmentDisplay(Adafruit_NeoPixel& led_strip) : strip(led_strip) {}
 
+  static uint8_t glyphMask(int value);
+  static int8_t glyphFor(char c);
+
   void setTime(int d1, int d2, int d3, int d4, int dot, int r, int g, int b);
-  void loading();
+  void setEffect(const Effect& newEffect);
+  void loading(system_tick_t now);
+
+  /**
+   * @brief Number of setTime() calls that sent a frame to the strip
+   */
+  uint32_t getFramesSent() const {
+    return framesSent;
+  }
+
+  /**
+   * @brief Number of setTime() calls skipped because nothing changed
+   */
+  uint32_t getFramesSkipped() const {
+    return framesSkipped;
+  }
+
+  /**
+   * @brief Time setTime() takes to draw a frame, not counting the show
+   */
+  const LatencyHistogram& getRenderLatency() const {
+    return renderLatency;
+  }
+
+  /**
+   * @brief Time the loop spends in the strip's show calls
+   */
+  const LatencyHistogram& getShowLatency() const {
+    return showLatency;
+  }
+
+  void resetLatency() {
+    renderLatency.reset();
+    showLatency.reset();
+  }
 
  private:
   Adafruit_NeoPixel& strip;
 
-  void updateDigit(uint8_t position, int8_t value);
+  void updateDigit(uint8_t position, int value);
   void updateDots(uint8_t mode);
+  void paint(uint16_t first, uint16_t count, bool isOn);
+  uint32_t shade(uint16_t led) const;
 
   int curr_r, curr_g, curr_b;
+
+  // Effect for the next frame, and the one the last frame was drawn with
+  Effect effect;
+  Effect currEffect;
+
+  // Last frame written to the strip, used to skip unchanged segments
+  bool frameValid = false;  // Cleared when the strip is drawn directly
+  int curr_digits[4];
+  int curr_dot;
+
+  uint32_t framesSent = 0;
+  uint32_t framesSkipped = 0;
+  LatencyHistogram renderLatency;
+  LatencyHistogram showLatency;
+
+  // Loading animation, advanced one step per loading() call when due
+  uint8_t loadingStep = 0;
+  system_tick_t loadingNext = 0;
 };
 
 #endif /* __SEGMENTDISPLAY_H */
\ No newline at end of file
@@ -0,0 +1,333 @@
+#ifndef __SEGMENTLAYOUT_H
+#define __SEGMENTLAYOUT_H
+
+#include <stdint.h>
+
+/**
+ * @brief A run of consecutive LEDs on the strip
+ */
+struct SegmentRun {
+  uint16_t first;
+  uint16_t count;
+};
+
+/**
+ * @brief Compile-time helpers for SegmentLayout
+ *
+ * Written as single-return recursive functions so they stay constant
+ * expressions under C++11.
+ */
+namespace segment_layout {
+
+static const uint8_t SEGMENTS = 7;  // a-g
+static const uint8_t SEPARATOR_UNITS = 3;  // Extra width taken by the dots
+
+/**
+ * @brief Number of bits set in 'bits'
+ */
+constexpr uint8_t bitCount(uint32_t bits) {
+  return bits ? (bits & 1) + bitCount(bits >> 1) : 0;
+}
+
+/**
+ * @brief Position of 'segment' in the wiring order, SEGMENTS if missing
+ */
+constexpr uint8_t slotOf(const uint8_t* wiring,
+                         uint8_t segment,
+                         uint8_t slot = 0) {
+  return slot == SEGMENTS || wiring[slot] == segment
+             ? slot
+             : slotOf(wiring, segment, slot + 1);
+}
+
+/**
+ * @brief true if every segment appears in the wiring order, so each of the
+ * SEGMENTS entries names a different one
+ */
+constexpr bool isPermutation(const uint8_t* wiring, uint8_t segment = 0) {
+  return segment == SEGMENTS || (slotOf(wiring, segment) < SEGMENTS &&
+                                 isPermutation(wiring, segment + 1));
+}
+
+/**
+ * @brief true for the horizontal segments (a, c and f), which span the
+ * digit's width; the others sit on its left or right edge
+ */
+constexpr bool isHorizontal(uint8_t segment) {
+  return segment == 0 || segment == 2 || segment == 5;
+}
+
+/**
+ * @brief true for the segments on the right edge of a digit (b and g)
+ */
+constexpr bool isRight(uint8_t segment) {
+  return segment == 1 || segment == 6;
+}
+
+/**
+ * @brief true if every one of 'runs' ends at or before 'limit'
+ */
+constexpr bool inBounds(const SegmentRun* runs,
+                        uint16_t count,
+                        uint16_t limit) {
+  return count == 0 || (runs[0].first + runs[0].count <= limit &&
+                        inBounds(runs + 1, count - 1, limit));
+}
+
+/**
+ * @brief Number of 'runs' covering 'led'
+ */
+constexpr uint8_t owners(const SegmentRun* runs, uint16_t count, uint16_t led) {
+  return count == 0 ? 0
+                    : (led >= runs[0].first &&
+                       led < runs[0].first + runs[0].count) +
+                          owners(runs + 1, count - 1, led);
+}
+
+/**
+ * @brief true if every LED in [first, last) is covered by exactly one run
+ *
+ * Splits the range in halves so the recursion depth stays logarithmic.
+ */
+constexpr bool coveredOnce(const SegmentRun* runs,
+                           uint16_t count,
+                           uint16_t first,
+                           uint16_t last) {
+  return last - first == 1
+             ? owners(runs, count, first) == 1
+             : coveredOnce(runs, count, first, (first + last) / 2) &&
+                   coveredOnce(runs, count, (first + last) / 2, last);
+}
+
+/**
+ * @brief Compile-time list of indices 0 to N - 1, see MakeIndices
+ */
+template <uint16_t... I>
+struct Indices {};
+
+template <uint16_t N, uint16_t... I>
+struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+
+template <uint16_t... I>
+struct MakeIndices<0, I...> {
+  typedef Indices<I...> type;
+};
+
+template <typename Layout, typename RunIndices, typename LedIndices>
+struct Tables;
+
+/**
+ * @brief Lookup tables generated from a SegmentLayout
+ *
+ * Instantiated on first use, once the layout is a complete type, which is
+ * also when the layout's static_asserts on bounds and overlap are checked.
+ */
+template <typename Layout, uint16_t... R, uint16_t... L>
+struct Tables<Layout, Indices<R...>, Indices<L...>> {
+  static constexpr SegmentRun RUNS[] = {Layout::run(R)...};
+  static constexpr SegmentRun ALL_RUNS[] = {Layout::run(R)...,
+                                            Layout::separator(R)...};
+  static constexpr uint8_t LED_X[] = {Layout::ledX(L)...};
+  static constexpr uint8_t LED_PATH[] = {Layout::ledPath(L)...};
+
+  static const uint16_t ALL_RUN_COUNT = 2 * sizeof...(R);
+
+  static_assert(inBounds(ALL_RUNS, ALL_RUN_COUNT, Layout::LED_COUNT),
+                "segments and separators must fit on the strip");
+  static_assert(coveredOnce(ALL_RUNS, ALL_RUN_COUNT, 0, Layout::LED_COUNT),
+                "every LED must belong to exactly one segment or separator");
+};
+
+template <typename Layout, uint16_t... R, uint16_t... L>
+constexpr SegmentRun Tables<Layout, Indices<R...>, Indices<L...>>::RUNS[];
+template <typename Layout, uint16_t... R, uint16_t... L>
+constexpr SegmentRun Tables<Layout, Indices<R...>, Indices<L...>>::ALL_RUNS[];
+template <typename Layout, uint16_t... R, uint16_t... L>
+constexpr uint8_t Tables<Layout, Indices<R...>, Indices<L...>>::LED_X[];
+template <typename Layout, uint16_t... R, uint16_t... L>
+constexpr uint8_t Tables<Layout, Indices<R...>, Indices<L...>>::LED_PATH[];
+
+}  // namespace segment_layout
+
+/**
+ * @brief Compile-time LED layout of a seven-segment NeoPixel display
+ *
+ * The strip runs through the digits from left to right. Each digit is 7
+ * segments of LedsPerSegment LEDs, chained in the order Wiring lists them
+ * (segment indices 0-6 for a-g, see SegmentDisplay.cpp). A separator of
+ * SeparatorLeds LEDs (the dots) is chained after every digit whose bit is
+ * set in Separators.
+ *
+ * From that, Tables provides, built at compile time and kept in flash:
+ * - RUNS: first LED and length of each segment, indexed by
+ *   digit * 7 + segment, so bit 'segment' of a digit's segment mask maps
+ *   straight to its run
+ * - LED_X: each LED's position across the display, 0-255
+ * - LED_PATH: each LED's position along its digit (or separator), 0-255
+ *
+ * Geometry for LED_X: a digit is LedsPerSegment + 2 units wide, digits
+ * are 1 unit apart, and a separator adds SEPARATOR_UNITS to the gap.
+ *
+ * Example, a 6-digit board with 10 LEDs per segment and dots after the
+ * second and fourth digits:
+ *   SegmentLayout<6, 10, 0x0A, 8, 0, 1, 2, 3, 4, 5, 6>
+ */
+template <uint8_t Digits,
+          uint8_t LedsPerSegment,
+          uint8_t Separators,
+          uint8_t SeparatorLeds,
+          uint8_t... Wiring>
+struct SegmentLayout {
+  static const uint8_t DIGITS = Digits;
+  static const uint8_t LEDS_PER_SEGMENT = LedsPerSegment;
+  static const uint8_t SEPARATORS = Separators;
+  static const uint8_t SEPARATOR_LEDS = SeparatorLeds;
+  static const uint8_t SEGMENTS = segment_layout::SEGMENTS;
+  static constexpr uint8_t WIRING_ORDER[] = {Wiring...};
+
+  static_assert(Digits > 0 && Digits <= 8, "1 to 8 digits");
+  static_assert(LedsPerSegment > 0, "segments need LEDs");
+  static_assert(Separators < (1u << Digits),
+                "separators can only follow existing digits");
+  static_assert(sizeof...(Wiring) == SEGMENTS,
+                "wiring order must list 7 segments");
+  static_assert(segment_layout::isPermutation(WIRING_ORDER),
+                "wiring order must list each segment a-g once");
+
+  static const uint16_t DIGIT_LEDS = SEGMENTS * LedsPerSegment;
+  static const uint8_t SEPARATOR_COUNT = segment_layout::bitCount(Separators);
+  static const uint16_t LED_COUNT =
+      Digits * DIGIT_LEDS + SEPARATOR_COUNT * SeparatorLeds;
+  static const uint8_t DIGIT_WIDTH = LedsPerSegment + 2;
+
+  /**
+   * @brief Number of separators chained before 'digit'
+   */
+  static constexpr uint8_t separatorsBefore(uint8_t digit) {
+    return segment_layout::bitCount(Separators & ((1u << digit) - 1));
+  }
+
+  /**
+   * @brief true if a separator is chained after 'digit'
+   */
+  static constexpr bool hasSeparator(uint8_t digit) {
+    return (Separators >> digit) & 1;
+  }
+
+  /**
+   * @brief First LED of 'digit'
+   */
+  static constexpr uint16_t digitFirst(uint8_t digit) {
+    return digit * DIGIT_LEDS + separatorsBefore(digit) * SeparatorLeds;
+  }
+
+  /**
+   * @brief First LED of the separator after 'digit'
+   */
+  static constexpr uint16_t separatorFirst(uint8_t digit) {
+    return digitFirst(digit) + DIGIT_LEDS;
+  }
+
+  /**
+   * @brief Run of segment 'index % 7' of digit 'index / 7'
+   */
+  static constexpr SegmentRun run(uint16_t index) {
+    return SegmentRun{
+        (uint16_t) (digitFirst(index / SEGMENTS) +
+                    segment_layout::slotOf(WIRING_ORDER, index % SEGMENTS) *
+                        LedsPerSegment),
+        LedsPerSegment};
+  }
+
+  /**
+   * @brief Run of the separator after digit 'index', empty if there is none
+   * (or 'index' is past the last digit)
+   */
+  static constexpr SegmentRun separator(uint16_t index) {
+    return index < Digits && hasSeparator(index)
+               ? SegmentRun{separatorFirst(index), SeparatorLeds}
+               : SegmentRun{0, 0};
+  }
+
+  /**
+   * @brief Digit that 'led' belongs to, or follows for separator LEDs
+   */
+  static constexpr uint8_t digitOf(uint16_t led, uint8_t digit = Digits - 1) {
+    return digit == 0 || digitFirst(digit) <= led ? digit
+                                                  : digitOf(led, digit - 1);
+  }
+
+  /**
+   * @brief Left edge of 'digit' in display units
+   */
+  static constexpr uint16_t digitX(uint8_t digit) {
+    return digit * (DIGIT_WIDTH + 1) +
+           separatorsBefore(digit) * segment_layout::SEPARATOR_UNITS;
+  }
+
+  /**
+   * @brief Right edge of the last digit in display units
+   */
+  static constexpr uint16_t width() {
+    return digitX(Digits - 1) + DIGIT_WIDTH - 1;
+  }
+
+  /**
+   * @brief Position of 'led' within its segment's width, in display units
+   *
+   * @param segment Segment index, 0-6 for a-g
+   * @param offset LED index within the segment
+   */
+  static constexpr uint8_t segmentX(uint8_t segment, uint16_t offset) {
+    return segment_layout::isHorizontal(segment) ? 1 + offset
+           : segment_layout::isRight(segment)    ? DIGIT_WIDTH - 1
+                                                 : 0;
+  }
+
+  /**
+   * @brief Position of 'led' across the display, 0-255
+   *
+   * Separator LEDs all sit half a unit right of the separator's left edge.
+   */
+  static constexpr uint8_t ledX(uint16_t led) {
+    return led - digitFirst(digitOf(led)) >= DIGIT_LEDS
+               ? ((digitX(digitOf(led)) + DIGIT_WIDTH + 1) * 2 + 1) * 255 /
+                     (width() * 2)
+               : (digitX(digitOf(led)) +
+                  segmentX(WIRING_ORDER[(led - digitFirst(digitOf(led))) /
+                                        LedsPerSegment],
+                           (led - digitFirst(digitOf(led))) %
+                               LedsPerSegment)) *
+                     255 / width();
+  }
+
+  /**
+   * @brief Position of 'led' along the strip within its digit or
+   * separator, 0-255
+   */
+  static constexpr uint8_t ledPath(uint16_t led) {
+    return led - digitFirst(digitOf(led)) >= DIGIT_LEDS
+               ? (led - separatorFirst(digitOf(led))) * 255 /
+                     (SeparatorLeds > 1 ? SeparatorLeds - 1 : 1)
+               : (led - digitFirst(digitOf(led))) * 255 / (DIGIT_LEDS - 1);
+  }
+
+  typedef segment_layout::Tables<
+      SegmentLayout,
+      typename segment_layout::MakeIndices<Digits * SEGMENTS>::type,
+      typename segment_layout::MakeIndices<LED_COUNT>::type>
+      Tables;
+};
+
+template <uint8_t Digits,
+          uint8_t LedsPerSegment,
+          uint8_t Separators,
+          uint8_t SeparatorLeds,
+          uint8_t... Wiring>
+constexpr uint8_t SegmentLayout<Digits,
+                                LedsPerSegment,
+                                Separators,
+                                SeparatorLeds,
+                                Wiring...>::WIRING_ORDER[];
+
+#endif /* __SEGMENTLAYOUT_H */
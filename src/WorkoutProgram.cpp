@@ -0,0 +1,174 @@
+#include "WorkoutProgram.h"
+
+/**
+ * @brief Colors assigned to consecutive sets
+ */
+static const uint8_t SET_COLORS[][3] = {
+    {0, 255, 0},    // Green
+    {0, 100, 255},  // Blue
+    {255, 0, 255},  // Magenta
+    {0, 255, 255},  // Cyan
+};
+static const uint8_t SET_COLOR_COUNT =
+    sizeof(SET_COLORS) / sizeof(SET_COLORS[0]);
+
+/**
+ * @brief Skips spaces and tabs
+ */
+static const char* skipSpaces(const char* p) {
+  while (*p == ' ' || *p == '\t' || *p == '\r') {
+    p++;
+  }
+  return p;
+}
+
+/**
+ * @brief Checks for the end of a set in the workout text
+ */
+static bool isSetEnd(char c) {
+  return c == '\0' || c == '\n' || c == ';';
+}
+
+/**
+ * @brief Compiles workout text into the set timeline
+ *
+ * Each set is "REPEATS x DISTANCE [STROKE...] @ M:SS". The distance and
+ * stroke are only there for the swimmers and are not stored. Intervals must
+ * be between 0:01 and 9:59 so the remaining time fits on the display.
+ *
+ * @param text Workout text, at most MAX_SOURCE characters
+ * @return true if the whole text compiled, false otherwise (the previous
+ *         program is kept)
+ */
+bool WorkoutProgram::compile(const char* text) {
+  if (strlen(text) > MAX_SOURCE) {
+    return false;
+  }
+
+  Set compiled[MAX_SETS];
+  uint8_t count = 0;
+  uint32_t offset = 0;
+
+  const char* p = text;
+  while (true) {
+    // Skip blank lines and separators
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' || *p == ';') {
+      p++;
+    }
+    if (*p == '\0') {
+      break;
+    }
+    if (count == MAX_SETS) {
+      return false;
+    }
+
+    char* end;
+    long repeats = strtol(p, &end, 10);
+    if (end == p || repeats <= 0 || repeats > 999) {
+      return false;
+    }
+    p = skipSpaces(end);
+    if (*p != 'x' && *p != 'X') {
+      return false;
+    }
+    p++;
+
+    long distance = strtol(p, &end, 10);
+    if (end == p || distance <= 0) {
+      return false;
+    }
+    p = end;
+
+    // Stroke is free text up to the interval
+    while (*p != '@' && !isSetEnd(*p)) {
+      p++;
+    }
+    if (*p != '@') {
+      return false;
+    }
+    p++;
+
+    long minutes = strtol(p, &end, 10);
+    if (end == p || *end != ':' || minutes < 0 || minutes > 9) {
+      return false;
+    }
+    p = end + 1;
+    long seconds = strtol(p, &end, 10);
+    if (end == p || seconds < 0 || seconds > 59) {
+      return false;
+    }
+    p = skipSpaces(end);
+    if (!isSetEnd(*p)) {
+      return false;
+    }
+
+    uint16_t interval = minutes * 60 + seconds;
+    if (interval == 0) {
+      return false;
+    }
+
+    Set& set = compiled[count];
+    set.startSec = offset;
+    set.intervalSec = interval;
+    set.repeats = repeats;
+    set.r = SET_COLORS[count % SET_COLOR_COUNT][0];
+    set.g = SET_COLORS[count % SET_COLOR_COUNT][1];
+    set.b = SET_COLORS[count % SET_COLOR_COUNT][2];
+    set.label = (count + 1) % 10;
+
+    offset += (uint32_t) interval * repeats;
+    count++;
+  }
+
+  if (count == 0) {
+    return false;
+  }
+
+  memcpy(sets, compiled, count * sizeof(Set));
+  setCount = count;
+  totalSec = offset;
+  strcpy(source, text);
+  return true;
+}
+
+/**
+ * @brief Finds the repeat running at a point in the program
+ *
+ * @param elapsedSec Seconds since the program started
+ * @param position Output parameter for the set, repeat and time left
+ * @return true if the program is running at elapsedSec, false if it has
+ *         finished or none is loaded
+ */
+bool WorkoutProgram::lookup(uint32_t elapsedSec, Position& position) const {
+  if (elapsedSec >= totalSec) {
+    return false;
+  }
+
+  // Last set starting at or before elapsedSec
+  uint8_t lo = 0;
+  uint8_t hi = setCount - 1;
+  while (lo < hi) {
+    uint8_t mid = (lo + hi + 1) / 2;
+    if (sets[mid].startSec <= elapsedSec) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+
+  const Set& set = sets[lo];
+  uint32_t setElapsedSec = elapsedSec - set.startSec;
+  position.set = &set;
+  position.repeat = setElapsedSec / set.intervalSec;
+  position.remainingSec = set.intervalSec - (setElapsedSec % set.intervalSec);
+  return true;
+}
+
+/**
+ * @brief Unloads the current program
+ */
+void WorkoutProgram::clear() {
+  setCount = 0;
+  totalSec = 0;
+  source[0] = '\0';
+}
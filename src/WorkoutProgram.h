@@ -0,0 +1,77 @@
+#ifndef __WORKOUTPROGRAM_H
+#define __WORKOUTPROGRAM_H
+
+#include "Particle.h"
+
+/**
+ * @brief A workout compiled into a timeline of interval sets
+ *
+ * Parses workout text in the usual swim notation, one set per line or
+ * separated by ';':
+ *
+ *   10 x 50 free @ 1:00
+ *   4 x 75 IM @ 1:30
+ *
+ * and compiles it up front into a flat array of sets, each with its start
+ * offset, interval and repeat count. Looking up the repeat running at a
+ * given time is then a binary search over the sets plus some arithmetic,
+ * with no parsing or allocation while the program runs.
+ */
+class WorkoutProgram {
+ public:
+  static const uint8_t MAX_SETS = 32;
+  static const size_t MAX_SOURCE = 255;  // Fits in one mesh event
+
+  /**
+   * @brief One compiled set: 'repeats' intervals of 'intervalSec' seconds
+   */
+  struct Set {
+    uint32_t startSec;     // Offset from the start of the program
+    uint16_t intervalSec;  // Time per repeat
+    uint16_t repeats;      // Number of repeats
+    uint8_t r, g, b;       // Display color
+    uint8_t label;         // Digit shown while the set runs
+  };
+
+  /**
+   * @brief Where in the program a point in time falls
+   */
+  struct Position {
+    const Set* set;
+    uint16_t repeat;        // 0-based repeat within the set
+    uint16_t remainingSec;  // Seconds left in the current repeat
+  };
+
+  bool compile(const char* text);
+  bool lookup(uint32_t elapsedSec, Position& position) const;
+  void clear();
+
+  /**
+   * @brief Checks if a program has been compiled
+   */
+  bool isLoaded() const {
+    return setCount > 0;
+  }
+
+  /**
+   * @brief Text the current program was compiled from
+   */
+  const char* getSource() const {
+    return source;
+  }
+
+  /**
+   * @brief Total length of the program in seconds
+   */
+  uint32_t getTotalSec() const {
+    return totalSec;
+  }
+
+ private:
+  Set sets[MAX_SETS];
+  uint8_t setCount = 0;
+  uint32_t totalSec = 0;
+  char source[MAX_SOURCE + 1] = "";
+};
+
+#endif /* __WORKOUTPROGRAM_H */